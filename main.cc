@@ -1,5 +1,6 @@
 #include "src/window.h"
 #include <spdlog/spdlog.h>
+#include <string_view>
 
 int main(int argc, char *argv[]) {
 #ifdef NDEBUG
@@ -9,5 +10,26 @@ int main(int argc, char *argv[]) {
     spdlog::info("Logging level is at debug");
     spdlog::set_level(spdlog::level::debug);
 #endif
-    vx::launchWindow("Voxel");
+
+    vx::WindowOptions options;
+    for (int ii = 1; ii < argc; ++ii) {
+        const std::string_view argument(argv[ii]);
+        if (argument == "--threaded-render") {
+            options.threadedRender = true;
+        } else if (argument == "--render-on-demand") {
+            options.renderOnDemand = true;
+        } else {
+            spdlog::warn("Ignoring unknown argument {}", argument);
+        }
+    }
+
+#ifdef __APPLE__
+    // Metal has to render on the main thread, which bgfx's render thread is not
+    if (options.threadedRender) {
+        spdlog::warn("Threaded rendering is not supported on this platform, rendering on the main thread");
+        options.threadedRender = false;
+    }
+#endif
+
+    vx::launchWindow("Voxel", options);
 }
\ No newline at end of file
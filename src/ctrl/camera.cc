@@ -90,6 +90,11 @@ namespace vx::ctrl {
         return projection_matrix_;
     }
 
+    auto Camera::eyePosition() -> vec3 {
+        compile();
+        return eye_;
+    }
+
     /// ==========================================
     void Camera::compile() {
         center_ = vec3(0.0f);
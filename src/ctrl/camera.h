@@ -44,6 +44,7 @@ namespace vx::ctrl {
 
         auto viewMatrix() -> mat4 &;
         auto projectionMatrix() -> mat4 &;
+        auto eyePosition() -> vec3;
         auto zoomAmount() const -> float;
         auto theta() const -> float;
         auto phi() const -> float;
@@ -0,0 +1,54 @@
+#include "blob_store.h"
+#include "../util/bytes.h"
+#include <spdlog/spdlog.h>
+
+namespace vx::gfx {
+    // The region file keys its slots by 16 byte ids, which a hash fills exactly
+    static auto blobKey(const util::Hash128 &hash) -> uuids::uuid {
+        std::array<uuids::uuid::value_type, 16> key{};
+        util::putLittleEndian<u64>(reinterpret_cast<u8 *>(key.data()), hash.low);
+        util::putLittleEndian<u64>(reinterpret_cast<u8 *>(key.data()) + 8, hash.high);
+        return uuids::uuid(key);
+    }
+
+    static auto blobHash(const uuids::uuid &key) -> util::Hash128 {
+        const auto bytes = key.as_bytes();
+        const auto *data = reinterpret_cast<const u8 *>(bytes.data());
+        return {util::getLittleEndian<u64>(data), util::getLittleEndian<u64>(data + 8)};
+    }
+
+    auto BlobStore::open(const std::filesystem::path &path) -> std::optional<BlobStore> {
+        auto file = RegionFile::open(path);
+        if (!file.has_value()) { return std::nullopt; }
+        return BlobStore(std::move(file.value()));
+    }
+
+    auto BlobStore::contains(const util::Hash128 &hash) const -> bool { return file_.contains(blobKey(hash)); }
+
+    auto BlobStore::read(const util::Hash128 &hash) -> std::optional<std::vector<u8>> {
+        return file_.read(blobKey(hash));
+    }
+
+    auto BlobStore::write(std::span<const BlobWrite> blobs) -> bool {
+        std::vector<RegionWrite> writes;
+        std::unordered_set<util::Hash128> written;
+        for (const auto &blob : blobs) {
+            if (contains(blob.hash) || !written.insert(blob.hash).second) { continue; }
+            writes.push_back({blobKey(blob.hash), blob.bytes});
+        }
+
+        if (writes.empty()) { return true; }
+        return file_.write(writes);
+    }
+
+    auto BlobStore::collect(const std::unordered_set<util::Hash128> &referenced) -> usize {
+        usize erased = 0;
+        for (const auto &key : file_.chunkIds()) {
+            if (referenced.contains(blobHash(key))) { continue; }
+            if (file_.erase(key)) { ++erased; }
+        }
+
+        if (erased > 0) { spdlog::info("Removed {} unreferenced blobs", erased); }
+        return erased;
+    }
+}// namespace vx::gfx
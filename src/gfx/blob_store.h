@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../math.h"
+#include "../util/hash.h"
+#include "region_file.h"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+namespace vx::gfx {
+    // The blob store's file in a project's game object folder
+    inline constexpr auto kBlobStoreFileName = "blobs.vxr";
+
+    struct BlobWrite {
+        util::Hash128 hash;
+        std::span<const u8> bytes;
+    };
+
+    /**
+     * Content addressed storage for the voxels of chunks serialized by encodeChunkBlob, each distinct blob is
+     * stored once however many chunks refer to it. Blobs sit in a region file keyed by their hash. Saving a chunk
+     * only ever adds blobs, the ones no chunk refers to any more are removed by collect.
+     */
+    class BlobStore {
+    public:
+        /**
+         * Opens a blob store, creating an empty one if it doesn't exist.
+         * @return The store, or nullopt if it could not be created or is not a region file
+         */
+        static auto open(const std::filesystem::path &path) -> std::optional<BlobStore>;
+
+        auto contains(const util::Hash128 &hash) const -> bool;
+        auto size() const -> usize { return file_.size(); }
+
+        /**
+         * @return The blob's bytes, or nullopt if it isn't stored or the read failed
+         */
+        auto read(const util::Hash128 &hash) -> std::optional<std::vector<u8>>;
+
+        /**
+         * Stores the blobs which aren't stored yet in one batch, a hash repeated in `blobs` is written once.
+         * @return Whether every blob is now stored
+         */
+        auto write(std::span<const BlobWrite> blobs) -> bool;
+
+        /**
+         * Erases every blob not in `referenced`, which must hold the blob of every chunk in the project.
+         * @return The number of blobs erased
+         */
+        auto collect(const std::unordered_set<util::Hash128> &referenced) -> usize;
+
+    private:
+        RegionFile file_;
+
+        explicit BlobStore(RegionFile file) : file_(std::move(file)) {}
+    };
+}// namespace vx::gfx
@@ -19,7 +19,7 @@ namespace vx::gfx {
 
     auto makeColorFromBlockType(BlockType blockType) -> vec4 {
         vec4 color;
-        switch (blockType) {
+        switch (knownBlockType(blockType)) {
             case BlockType::kDefault:
                 color = vec4(1, 1, 1, 1);
                 break;
@@ -29,12 +29,13 @@ namespace vx::gfx {
             case BlockType::kGrass:
                 color = vec4(0.84, 0.92, 0.79, 1);
                 break;
-            case BlockType::kDebug:
+            case BlockType::kDebug: {
                 std::random_device r;
                 std::mt19937 engine(r());
                 std::uniform_real_distribution<f32> distr(0, 1);
                 color = vec4(distr(engine), distr(engine), distr(engine), distr(engine));
                 break;
+            }
         }
 
         return color;
@@ -54,6 +55,8 @@ namespace vx::gfx {
             case BlockType::kDebug:
                 return BlockTypeStringkDebug;
                 break;
+            default:
+                return BlockTypeStringkDebug;
         }
     }
 
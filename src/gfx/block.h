@@ -2,7 +2,6 @@
 
 #include "../math.h"
 #include "../util/colors.h"
-#include "bgfx.h"
 #include "primitive.h"
 #include <array>
 #include <random>
@@ -67,7 +66,17 @@ namespace vx::gfx {
 
     using BlockIndexSize = u32;
 
-    enum BlockType { kDefault = 0, kGrass, kDirt, kDebug };
+    enum BlockType : u8 { kDefault = 0, kGrass, kDirt, kDebug };
+    static constexpr int kBlockTypes = 4;
+
+    // Whether a byte read from a file names a BlockType
+    inline auto isBlockType(u8 value) -> bool { return value < kBlockTypes; }
+
+    // Mapped voxels are never checked for unknown types, so whatever reads them draws those as kDebug blocks
+    inline auto knownBlockType(BlockType blockType) -> BlockType {
+        return isBlockType(blockType) ? blockType : BlockType::kDebug;
+    }
+
     inline const std::array<char *, 4> kAvailableBlockTypes = {(char *) "default", (char *) "grass", (char *) "dirt",
                                                                (char *) "debug"};
     inline auto blockTypeFromString(const std::string &blockType) -> BlockType {
@@ -98,6 +107,24 @@ namespace vx::gfx {
             0, 3, 7, 0, 7, 4,// Down
     };
 
+    /**
+     * Face directions in the order chunk meshes bucket their indices. Each direction owns one contiguous range
+     * of a chunk's index buffer so whole directions can be skipped when they face away from the camera.
+     */
+    enum FaceDirection { kPositiveX = 0, kNegativeX, kPositiveY, kNegativeY, kPositiveZ, kNegativeZ };
+    static constexpr int kFaceDirections = 6;
+    static constexpr int kIndicesPerFace = 6;
+
+    // Offset of each FaceDirection's quad within kBlockIndices
+    static constexpr std::array<int, kFaceDirections> kBlockFaceIndexOffsets{
+            12,// East  (+x)
+            18,// West  (-x)
+            24,// Up    (+y)
+            30,// Down  (-y)
+            0, // South (+z)
+            6, // North (-z)
+    };
+
     auto makeOffsetCubeVertices(const vec3 &startingPosition) -> std::array<vec3, 8>;
     auto makeColorFromBlockType(BlockType blockType) -> vec4;
     auto blockTypeToString(BlockType blockType) -> std::string;
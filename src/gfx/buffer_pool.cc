@@ -0,0 +1,155 @@
+#include "buffer_pool.h"
+#include "chunk_renderer.h"
+#include <algorithm>
+#include <bit>
+#include <spdlog/spdlog.h>
+
+namespace vx::gfx {
+    auto bufferSizeClass(u32 nElements) -> u32 {
+        const u32 sizeClass = std::bit_width(std::max(nElements, 1u) - 1);
+        return std::max(sizeClass, kMinBufferSizeClass) - kMinBufferSizeClass;
+    }
+
+    /**
+     * Number of elements held by the buffers of a size class.
+     */
+    static auto sizeClassCapacity(u32 sizeClass) -> u32 { return 1u << (sizeClass + kMinBufferSizeClass); }
+
+    static auto vertexBufferBytes(u32 sizeClass) -> u64 {
+        return static_cast<u64>(sizeClassCapacity(sizeClass)) * sizeof(VertexColor);
+    }
+
+    static auto indexBufferBytes(u32 sizeClass) -> u64 {
+        return static_cast<u64>(sizeClassCapacity(sizeClass)) * sizeof(BlockIndexSize);
+    }
+
+    /**
+     * Moves the pending buffers which are old enough to the free lists.
+     */
+    template<typename Pending, typename FreeLists, typename BufferBytes>
+    static void reclaim(std::vector<Pending> &pending, FreeLists &freeLists, u64 frame, BufferBytes bufferBytes,
+                        BufferPoolStats &stats) {
+        std::erase_if(pending, [&](const Pending &buffer) {
+            if (buffer.releaseFrame + kBufferReleaseLatency > frame) { return false; }
+            freeLists.at(buffer.sizeClass).push_back(buffer.handle);
+            --stats.pending;
+            ++stats.free;
+            stats.freeBytes += bufferBytes(buffer.sizeClass);
+            return true;
+        });
+    }
+
+    BufferPool::BufferPool() : vertexLayout_(makeChunkVertexLayout()) {}
+
+    auto BufferPool::acquire(u32 nVertices, u32 nIndices) -> PooledBuffers {
+        const u32 vertexClass = bufferSizeClass(nVertices);
+        const u32 indexClass = bufferSizeClass(nIndices);
+        if (vertexClass >= kBufferSizeClasses || indexClass >= kBufferSizeClasses) {
+            spdlog::error("Mesh of {} vertices and {} indices is too large for the buffer pool", nVertices, nIndices);
+            return {};
+        }
+
+        PooledBuffers buffers;
+        buffers.vertexCapacity = sizeClassCapacity(vertexClass);
+        buffers.indexCapacity = sizeClassCapacity(indexClass);
+
+        auto &freeVertexBuffers = freeVertexBuffers_.at(vertexClass);
+        if (freeVertexBuffers.empty()) {
+            buffers.vertexBuffer = bgfx::createDynamicVertexBuffer(buffers.vertexCapacity, vertexLayout_);
+            ++stats_.misses;
+        } else {
+            buffers.vertexBuffer = freeVertexBuffers.back();
+            freeVertexBuffers.pop_back();
+            --stats_.free;
+            stats_.freeBytes -= vertexBufferBytes(vertexClass);
+            ++stats_.hits;
+        }
+
+        auto &freeIndexBuffers = freeIndexBuffers_.at(indexClass);
+        if (freeIndexBuffers.empty()) {
+            buffers.indexBuffer = bgfx::createDynamicIndexBuffer(buffers.indexCapacity, BGFX_BUFFER_INDEX32);
+            ++stats_.misses;
+        } else {
+            buffers.indexBuffer = freeIndexBuffers.back();
+            freeIndexBuffers.pop_back();
+            --stats_.free;
+            stats_.freeBytes -= indexBufferBytes(indexClass);
+            ++stats_.hits;
+        }
+
+        return buffers;
+    }
+
+    void BufferPool::release(PooledBuffers &buffers) {
+        if (!buffers.valid()) { return; }
+
+        pendingVertexBuffers_.push_back({buffers.vertexBuffer, bufferSizeClass(buffers.vertexCapacity), frame_});
+        pendingIndexBuffers_.push_back({buffers.indexBuffer, bufferSizeClass(buffers.indexCapacity), frame_});
+        stats_.pending += 2;
+
+        buffers = {};
+    }
+
+    void BufferPool::upload(PooledBuffers &buffers, const std::vector<VertexColor> &vertices,
+                            const std::vector<BlockIndexSize> &indices) {
+        if (!buffers.valid() || vertices.size() > buffers.vertexCapacity || indices.size() > buffers.indexCapacity) {
+            release(buffers);
+            buffers = acquire(vertices.size(), indices.size());
+            if (!buffers.valid()) { return; }
+        }
+
+        // bgfx rejects empty copies, an empty mesh has no face ranges to draw anyway
+        if (!vertices.empty()) {
+            bgfx::update(buffers.vertexBuffer, 0, bgfx::copy(vertices.data(), vertices.size() * sizeof(vertices[0])));
+        }
+        if (!indices.empty()) {
+            bgfx::update(buffers.indexBuffer, 0, bgfx::copy(indices.data(), indices.size() * sizeof(indices[0])));
+        }
+    }
+
+    void BufferPool::nextFrame() {
+        ++frame_;
+        reclaim(pendingVertexBuffers_, freeVertexBuffers_, frame_, vertexBufferBytes, stats_);
+        reclaim(pendingIndexBuffers_, freeIndexBuffers_, frame_, indexBufferBytes, stats_);
+    }
+
+    void BufferPool::trim(u64 maxFreeBytes) {
+        for (int sizeClass = kBufferSizeClasses - 1; sizeClass >= 0 && stats_.freeBytes > maxFreeBytes; --sizeClass) {
+            auto &freeVertexBuffers = freeVertexBuffers_.at(sizeClass);
+            while (!freeVertexBuffers.empty() && stats_.freeBytes > maxFreeBytes) {
+                bgfx::destroy(freeVertexBuffers.back());
+                freeVertexBuffers.pop_back();
+                --stats_.free;
+                stats_.freeBytes -= vertexBufferBytes(sizeClass);
+            }
+
+            auto &freeIndexBuffers = freeIndexBuffers_.at(sizeClass);
+            while (!freeIndexBuffers.empty() && stats_.freeBytes > maxFreeBytes) {
+                bgfx::destroy(freeIndexBuffers.back());
+                freeIndexBuffers.pop_back();
+                --stats_.free;
+                stats_.freeBytes -= indexBufferBytes(sizeClass);
+            }
+        }
+    }
+
+    void BufferPool::destroy() {
+        spdlog::info("Destroying buffer pool, {} hits, {} misses", stats_.hits, stats_.misses);
+        for (const auto &buffer : pendingVertexBuffers_) { bgfx::destroy(buffer.handle); }
+        for (const auto &buffer : pendingIndexBuffers_) { bgfx::destroy(buffer.handle); }
+        for (const auto &freeList : freeVertexBuffers_) {
+            for (const auto &handle : freeList) { bgfx::destroy(handle); }
+        }
+        for (const auto &freeList : freeIndexBuffers_) {
+            for (const auto &handle : freeList) { bgfx::destroy(handle); }
+        }
+
+        pendingVertexBuffers_.clear();
+        pendingIndexBuffers_.clear();
+        freeVertexBuffers_ = {};
+        freeIndexBuffers_ = {};
+        stats_.pending = 0;
+        stats_.free = 0;
+        stats_.freeBytes = 0;
+    }
+}// namespace vx::gfx
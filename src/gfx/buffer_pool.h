@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../math.h"
+#include "bgfx.h"
+#include "block.h"
+#include "primitive.h"
+#include <array>
+#include <vector>
+
+namespace vx::gfx {
+    // Buffers hold a power of two number of elements, starting at 2^kMinBufferSizeClass
+    static constexpr u32 kMinBufferSizeClass = 8;
+    static constexpr u32 kBufferSizeClasses = 24;
+
+    // Frames a released buffer waits before it is handed out again. bgfx renders the previous frame while the
+    // next one is recorded, the extra frame is margin for the driver.
+    static constexpr u64 kBufferReleaseLatency = 3;
+
+    // Free buffers kept around for reuse beyond this many bytes are destroyed by trim()
+    static constexpr u64 kMaxFreeBufferBytes = 64ull * 1024 * 1024;
+
+    /**
+     * The smallest size class holding `nElements`.
+     */
+    auto bufferSizeClass(u32 nElements) -> u32;
+
+    struct PooledBuffers {
+        bgfx::DynamicVertexBufferHandle vertexBuffer = BGFX_INVALID_HANDLE;
+        bgfx::DynamicIndexBufferHandle indexBuffer = BGFX_INVALID_HANDLE;
+
+        // In elements (vertices and indices), not bytes
+        u32 vertexCapacity = 0;
+        u32 indexCapacity = 0;
+
+        auto valid() const -> bool { return bgfx::isValid(vertexBuffer); }
+        auto gpuBytes() const -> u64 {
+            return static_cast<u64>(vertexCapacity) * sizeof(VertexColor) +
+                   static_cast<u64>(indexCapacity) * sizeof(BlockIndexSize);
+        }
+    };
+
+    struct BufferPoolStats {
+        // Buffers served from the free lists and buffers that had to be created
+        u64 hits = 0;
+        u64 misses = 0;
+
+        // Buffers waiting out kBufferReleaseLatency and buffers ready for reuse
+        u32 pending = 0;
+        u32 free = 0;
+        u64 freeBytes = 0;
+    };
+
+    /**
+     * Recycles the dynamic vertex and index buffers of chunk meshes so add, edit and delete churn reuses buffers
+     * instead of creating and destroying them. Vertex and index buffers are pooled separately in power of two
+     * size classes.
+     */
+    class BufferPool {
+    public:
+        BufferPool();
+
+        /**
+         * Takes buffers large enough for the given number of vertices and indices from the pool, creating them on
+         * a miss. The contents are undefined until uploaded.
+         */
+        auto acquire(u32 nVertices, u32 nIndices) -> PooledBuffers;
+
+        /**
+         * Returns buffers to the pool, they stay untouched until the frames which may still draw them are done.
+         */
+        void release(PooledBuffers &buffers);
+
+        /**
+         * Uploads a mesh, swapping `buffers` for larger ones first if it doesn't fit.
+         */
+        void upload(PooledBuffers &buffers, const std::vector<VertexColor> &vertices,
+                    const std::vector<BlockIndexSize> &indices);
+
+        /**
+         * Advances the pool by a frame, making the buffers released kBufferReleaseLatency frames ago reusable.
+         */
+        void nextFrame();
+
+        /**
+         * Destroys free buffers, largest first, until at most `maxFreeBytes` are kept for reuse.
+         */
+        void trim(u64 maxFreeBytes = kMaxFreeBufferBytes);
+        void destroy();
+
+        auto vertexLayout() const -> const bgfx::VertexLayout & { return vertexLayout_; }
+        auto stats() const -> const BufferPoolStats & { return stats_; }
+
+    private:
+        template<typename Handle>
+        struct PendingBuffer {
+            Handle handle;
+            u32 sizeClass;
+            u64 releaseFrame;
+        };
+
+        template<typename Handle>
+        using FreeLists = std::array<std::vector<Handle>, kBufferSizeClasses>;
+
+        u64 frame_ = 0;
+        BufferPoolStats stats_;
+        bgfx::VertexLayout vertexLayout_;
+
+        FreeLists<bgfx::DynamicVertexBufferHandle> freeVertexBuffers_;
+        FreeLists<bgfx::DynamicIndexBufferHandle> freeIndexBuffers_;
+        std::vector<PendingBuffer<bgfx::DynamicVertexBufferHandle>> pendingVertexBuffers_;
+        std::vector<PendingBuffer<bgfx::DynamicIndexBufferHandle>> pendingIndexBuffers_;
+    };
+}// namespace vx::gfx
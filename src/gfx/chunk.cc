@@ -1,14 +1,21 @@
 #include "chunk.h"
-#include "../level_editor/project.h"
 #include "../paths.h"
 #include "../util//strings.h"
+#include "../util/hash.h"
+#include "chunk_file.h"
+#include "legacy_chunk.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <pugixml.hpp>
+#include <mutex>
 #include <spdlog/spdlog.h>
+#include <unordered_map>
 #include <utility>
 
 namespace vx::gfx {
+    // Meshes no chunk holds any more are swept out once the table grows past this, then past twice its size
+    static constexpr usize kMinMeshSweepSize = 64;
+
     Chunk::Chunk(const ivec3 &chunkSize, const vec3 &chunkTranslation, std::string moduleName, std::string _name,
                  bool _isStatic, const BlockType &_blockType)
         : shaderModule(std::move(moduleName)), name(std::move(_name)), isStatic(_isStatic) {
@@ -28,113 +35,10 @@ namespace vx::gfx {
         spdlog::debug("Chunk loaded successfully");
     }
 
-    void Chunk::write() const noexcept {
-        pugi::xml_document chunkDocument;
-        pugi::xml_node projectNode = level_editor::Project::instance()->projectXMLHeader(chunkDocument);
-
-        pugi::xml_node identifierComponent = projectNode.append_child("component");
-        identifierComponent.append_attribute("name") = "id";
-        identifierComponent.append_attribute("value") = uuids::to_string(id).c_str();
-
-        pugi::xml_node nameComponent = projectNode.append_child("component");
-        nameComponent.append_attribute("name") = "name";
-        nameComponent.append_attribute("value") = name.c_str();
-
-        pugi::xml_node shaderModuleComponent = projectNode.append_child("component");
-        shaderModuleComponent.append_attribute("name") = "shaderModule";
-        shaderModuleComponent.append_attribute("value") = shaderModule.c_str();
-
-        pugi::xml_node isStaticComponent = projectNode.append_child("component");
-        isStaticComponent.append_attribute("name") = "isStatic";
-        isStaticComponent.append_attribute("value") = isStatic;
-
-        pugi::xml_node dimensionsComponent = projectNode.append_child("component");
-        dimensionsComponent.append_attribute("name") = "dimensions";
-        pugi::xml_node dimensionsMapComponent = dimensionsComponent.append_child("map");
-        pugi::xml_node xDimEntry = dimensionsMapComponent.append_child("entry");
-        xDimEntry.append_attribute("key") = "xdim";
-        xDimEntry.append_attribute("value") = xdim;
-
-        pugi::xml_node yDimEntry = dimensionsMapComponent.append_child("entry");
-        yDimEntry.append_attribute("key") = "ydim";
-        yDimEntry.append_attribute("value") = ydim;
-
-        pugi::xml_node zDimEntry = dimensionsMapComponent.append_child("entry");
-        zDimEntry.append_attribute("key") = "zdim";
-        zDimEntry.append_attribute("value") = zdim;
-
-        pugi::xml_node transformComponent = projectNode.append_child("component");
-        transformComponent.append_attribute("name") = "transform";
-        pugi::xml_node transformMapComponent = transformComponent.append_child("map");
-        pugi::xml_node xtransformEntry = transformMapComponent.append_child("entry");
-        xtransformEntry.append_attribute("key") = "xtransform";
-        xtransformEntry.append_attribute("value") = xtransform;
-
-        pugi::xml_node ytransformEntry = transformMapComponent.append_child("entry");
-        ytransformEntry.append_attribute("key") = "ytransform";
-        ytransformEntry.append_attribute("value") = ytransform;
-
-        pugi::xml_node ztransformEntry = transformMapComponent.append_child("entry");
-        ztransformEntry.append_attribute("key") = "ztransform";
-        ztransformEntry.append_attribute("value") = ztransform;
-
-
-        // Write the indices of this chunk
-        pugi::xml_node indicesComponent = projectNode.append_child("component");
-        indicesComponent.append_attribute("name") = "indices";
-
-        pugi::xml_node indicesComponentNNodesProperty = indicesComponent.append_child("property");
-        indicesComponentNNodesProperty.append_attribute("name") = "nNodes";
-        indicesComponentNNodesProperty.append_attribute("value") = indices.size();
-
-        pugi::xml_node indicesList = indicesComponent.append_child("indices-list");
-        for (const auto &index : indices) {
-            pugi::xml_node itemNode = indicesList.append_child("item");
-            itemNode.append_attribute("index") = index;
-        }
-
-        // Write the vertices
-        pugi::xml_node verticesComponent = projectNode.append_child("component");
-        verticesComponent.append_attribute("name") = "vertices";
-
-        pugi::xml_node verticesComponentNNodesProperty = verticesComponent.append_child("property");
-        verticesComponentNNodesProperty.append_attribute("name") = "nNodes";
-        verticesComponentNNodesProperty.append_attribute("value") = geometry.size();
-
-        pugi::xml_node verticesComponentBlockTypeProperty = verticesComponent.append_child("property");
-        verticesComponentBlockTypeProperty.append_attribute("name") = "blockType";
-        verticesComponentBlockTypeProperty.append_attribute("value") = gfx::blockTypeToString(blockType).c_str();
-
-        pugi::xml_node verticesComponentVertexTypeProperty = verticesComponent.append_child("property");
-        verticesComponentVertexTypeProperty.append_attribute("name") = "vertexType";
-        verticesComponentVertexTypeProperty.append_attribute("value") = "VertexColor";
-
-        pugi::xml_node verticesList = verticesComponent.append_child("vertices-list");
-        int ii = 0;
-        for (const auto &[position, _color] : geometry) {
-            const auto &x = position.x;
-            const auto &y = position.y;
-            const auto &z = position.z;
-
-            // Make a vertex top-level element
-            pugi::xml_node vertexNode = verticesList.append_child("item");
-            vertexNode.append_attribute("index") = ii;
-            vertexNode.append_attribute("xpos") = x;
-            vertexNode.append_attribute("ypos") = y;
-            vertexNode.append_attribute("zpos") = z;
-            ++ii;
-        }
-
-        // Save the file to our pre-determined path
-        const auto filepath =
-                level_editor::Project::instance()->gameObjectFolderPath() / fs::path(name + paths::kXmlPostfix);
-        chunkDocument.save_file(filepath.string().c_str());
-    }
-
     void Chunk::setGeometry(const ivec3 &chunkSize, const vec3 &chunkTranslation, const BlockType &_blockType) {
         // Clear any existing memory.
-        geometry.clear();
-        indices.clear();
+        voxels.clear();
+        mesh = nullptr;
 
         // Set block type
         blockType = _blockType;
@@ -147,161 +51,101 @@ namespace vx::gfx {
         ytransform = chunkTranslation.y;
         ztransform = chunkTranslation.z;
 
-        // Origin point is always 0 0 0, so we draw from there
-        u64 ii = 0;
-        for (int xx = 0; xx < chunkSize.x; ++xx) {
-            for (int yy = 0; yy < chunkSize.y; ++yy) {
-                for (int zz = 0; zz < chunkSize.z; ++zz) {
-                    auto baseIndices = kBlockIndices;
+        // Chunks are currently solid blocks of a single type
+        voxels.assign(static_cast<usize>(xdim) * ydim * zdim, blockType);
+        makeGeometry();
+    }
 
-                    // Increment indices to avoid overlapping faces
-                    for (auto &index : baseIndices) {
-                        index += kCubeVertices.size() * ii;
-                        indices.push_back(index);
-                    }
+    void Chunk::makeGeometry() { mesh = shareChunkMesh(voxels, dimensions()); }
 
-                    const vec4 color = makeColorFromBlockType(blockType);
-                    const vec3 startingPosition = vec3(xx, yy, zz);
-                    for (const auto &vertex : makeOffsetCubeVertices(startingPosition)) {
-                        geometry.emplace_back(vertex, color);
+    static auto buildChunkMesh(const VoxelStorage &voxels, const ivec3 &dimensions) -> ChunkMesh {
+        ChunkMesh mesh;
+        mesh.vertices.reserve(voxels.size() * kCubeVertices.size());
+
+        // Origin point is always 0 0 0, so we draw from there
+        usize index = 0;
+        for (int xx = 0; xx < dimensions.x; ++xx) {
+            for (int yy = 0; yy < dimensions.y; ++yy) {
+                for (int zz = 0; zz < dimensions.z; ++zz) {
+                    const vec4 color = makeColorFromBlockType(voxels.at(index++));
+                    for (const auto &vertex : makeOffsetCubeVertices(vec3(xx, yy, zz))) {
+                        mesh.vertices.emplace_back(vertex, color);
                     }
-                    ++ii;
                 }
             }
         }
 
-        // Translate the chunk.
-        for (auto &[pos, _] : geometry) { pos += chunkTranslation; }
-
-        // Write the new data.
-        write();
+        makeFaceBucketedIndices(mesh.vertices.size() / kCubeVertices.size(), mesh.indices, mesh.faceRanges);
+        return mesh;
     }
 
-    auto Chunk::operator==(const gfx::Chunk &other) const -> bool { return id == other.id; }
-
-    auto Chunk::load(const std::filesystem::path &path) -> std::optional<Chunk> {
-        spdlog::debug("Loading chunk path {}", path.string());
-        pugi::xml_document chunkDocument;
-        pugi::xml_parse_result parseResult = chunkDocument.load_file(path.c_str());
-        // If failure, spit out the error
-        if (!parseResult) {
-            spdlog::error("Failed to load project file with error: {}", parseResult.description());
-            return std::nullopt;
-        }
-
-        // Top-level chunk element
-        const pugi::xml_node projectNode = chunkDocument.child("project");
-
-        spdlog::debug("Loading Identifier Component");
-        const pugi::xml_node identifierComponent = projectNode.child("component");
-        const uuids::uuid identifier = uuids::uuid::from_string(identifierComponent.attribute("value").value()).value();
+    static auto chunkMeshKey(const VoxelStorage &voxels, const ivec3 &dimensions) -> util::Hash128 {
+        auto key = util::contentHash({reinterpret_cast<const u8 *>(voxels.data()), voxels.size()});
 
-        spdlog::debug("Loading Name Component");
-        const pugi::xml_node nameComponent = identifierComponent.next_sibling();
-        const std::string name = nameComponent.attribute("value").value();
-
-        spdlog::debug("Loading Shader Module Component");
-        const pugi::xml_node shaderModuleComponent = nameComponent.next_sibling();
-        const std::string shaderModule = shaderModuleComponent.attribute("value").value();
+        // Chunks of different shapes can hold the same voxels
+        key.low ^= util::xxHash64({reinterpret_cast<const u8 *>(&dimensions), sizeof(dimensions)});
+        return key;
+    }
 
-        spdlog::debug("Loading Fixture Component");
-        const pugi::xml_node isStaticComponent = shaderModuleComponent.next_sibling();
-        const bool isStatic = std::strcmp(isStaticComponent.attribute("value").value(), "true") == 0;
+    auto shareChunkMesh(const VoxelStorage &voxels, const ivec3 &dimensions) -> std::shared_ptr<const ChunkMesh> {
+        static std::mutex mutex;
+        static std::unordered_map<util::Hash128, std::weak_ptr<const ChunkMesh>> meshes;
+        static usize sweepSize = kMinMeshSweepSize;
 
-        spdlog::debug("Loading Dimensions");
-        ivec3 dimensions;
-        const pugi::xml_node dimensionsComponent = isStaticComponent.next_sibling();
+        const auto key = chunkMeshKey(voxels, dimensions);
         {
-            const pugi::xml_node mapNode = dimensionsComponent.child("map");
-            // Unroll the dimensions
-#pragma unroll
-            for (const auto &child : mapNode.children()) {
-                if (std::strcmp(child.attribute("key").value(), "xdim") == 0) {
-                    dimensions.x = std::stoi(child.attribute("value").value());
-                }
-
-                if (std::strcmp(child.attribute("key").value(), "ydim") == 0) {
-                    dimensions.y = std::stoi(child.attribute("value").value());
-                }
-
-                if (std::strcmp(child.attribute("key").value(), "zdim") == 0) {
-                    dimensions.z = std::stoi(child.attribute("value").value());
-                }
+            std::lock_guard lock(mutex);
+            const auto found = meshes.find(key);
+            if (found != meshes.end()) {
+                if (auto mesh = found->second.lock()) { return mesh; }
             }
         }
 
-        spdlog::debug("Loading Transform");
-        const pugi::xml_node transformComponent = dimensionsComponent.next_sibling();
-        vec3 transform;
-        {
-            const pugi::xml_node mapNode = transformComponent.child("map");
-            // Unroll the transform
-#pragma unroll
-            for (const auto &child : mapNode.children()) {
-                if (std::strcmp(child.attribute("key").value(), "xtransform") == 0) {
-                    transform.x = std::stoi(child.attribute("value").value());
-                }
+        // Meshed outside the lock, if another thread meshed the same voxels meanwhile its mesh wins
+        auto mesh = std::make_shared<const ChunkMesh>(buildChunkMesh(voxels, dimensions));
 
-                if (std::strcmp(child.attribute("key").value(), "ytransform") == 0) {
-                    transform.y = std::stoi(child.attribute("value").value());
-                }
+        std::lock_guard lock(mutex);
+        auto &entry = meshes[key];
+        if (auto existing = entry.lock()) { return existing; }
+        entry = mesh;
 
-                if (std::strcmp(child.attribute("key").value(), "ztransform") == 0) {
-                    transform.z = std::stoi(child.attribute("value").value());
-                }
-            }
+        if (meshes.size() > sweepSize) {
+            std::erase_if(meshes, [](const auto &pair) { return pair.second.expired(); });
+            sweepSize = std::max(kMinMeshSweepSize, 2 * meshes.size());
         }
+        return mesh;
+    }
 
-        // Unpack the indices
-        spdlog::debug("Loading Indices");
-        std::vector<BlockIndexSize> indices;
-        const pugi::xml_node indicesComponent = transformComponent.next_sibling();
-        {
-            const int nNodes = std::stoi(indicesComponent.child("property").attribute("value").value());
-            const pugi::xml_node indicesList = indicesComponent.child("indices-list");
-            for (const auto &child : indicesList.children()) {
-                // Might cause a truncation issue?
-                indices.push_back(std::stoi(child.attribute("index").value()));
+    void makeFaceBucketedIndices(u64 nBlocks, std::vector<BlockIndexSize> &indices,
+                                 std::array<IndexRange, kFaceDirections> &faceRanges) {
+        indices.clear();
+        indices.reserve(nBlocks * kBlockIndices.size());
+
+        // Lay the faces out one direction at a time so each direction is a single contiguous range.
+        for (int direction = 0; direction < kFaceDirections; ++direction) {
+            faceRanges.at(direction).start = indices.size();
+
+            const auto faceOffset = kBlockFaceIndexOffsets.at(direction);
+            for (u64 ii = 0; ii < nBlocks; ++ii) {
+                // Increment indices to avoid overlapping faces
+                const auto baseVertex = kCubeVertices.size() * ii;
+                for (int jj = 0; jj < kIndicesPerFace; ++jj) {
+                    indices.push_back(kBlockIndices.at(faceOffset + jj) + baseVertex);
+                }
             }
 
-#ifndef NDEBUG
-            assert(indices.size() == nNodes && "INVALID NODE LOAD OPERATION");
-#endif
+            faceRanges.at(direction).count = indices.size() - faceRanges.at(direction).start;
         }
+    }
 
-        // Unpack the vertices
-        spdlog::debug("Loading Vertices");
-        std::vector<VertexColor> vertices;
-        const pugi::xml_node verticesComponent = indicesComponent.next_sibling();
-        const pugi::xml_node nNodesProperty = verticesComponent.child("property");
-        const int nNodes = std::stoi(nNodesProperty.attribute("value").value());
-        const pugi::xml_node blockTypeProperty = nNodesProperty.next_sibling();
-        const BlockType blockType = stringToBlockType(blockTypeProperty.attribute("value").value());
-        {
-
-            // Ignore for now since we are currently only using one vertex type
-            const pugi::xml_node vertexTypeProperty = blockTypeProperty.next_sibling();
-            const pugi::xml_node verticesList = vertexTypeProperty.next_sibling();
-            vec4 color = makeColorFromBlockType(blockType);
-            int ii = 0;
-            for (const auto &child : verticesList.children()) {
-                const u32 xpos = std::stoi(child.attribute("xpos").value());
-                const u32 ypos = std::stoi(child.attribute("ypos").value());
-                const u32 zpos = std::stoi(child.attribute("zpos").value());
-                const vec3 position(xpos, ypos, zpos);
+    auto Chunk::operator==(const gfx::Chunk &other) const -> bool { return id == other.id; }
 
-                // Evil hack to get the colors right
-                if (ii % gfx::kCubeVertices.size() == 0) { color = makeColorFromBlockType(blockType); }
-                vertices.emplace_back(position, color);
-                ++ii;
-            }
-#ifndef NDEBUG
-            assert(vertices.size() == nNodes && "INVALID VERTEX LOAD OPERATION");
-#endif
-        }
+    auto Chunk::load(const std::filesystem::path &path) -> std::optional<Chunk> {
+        spdlog::debug("Loading chunk path {}", path.string());
+        if (path.extension() == paths::kChunkPostfix) { return readChunkFile(path); }
 
-        return Chunk(isStatic, blockType, name, shaderModule, identifier, dimensions.x, dimensions.y, dimensions.z,
-                     transform.x, transform.y, transform.z, indices, vertices);
+        // Legacy XML chunk
+        return readLegacyChunkFile(path);
     }
 
 }// namespace vx::gfx
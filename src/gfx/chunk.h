@@ -1,10 +1,13 @@
 #pragma once
 
+#include "../util/slot_map.h"
 #include "../util/uuid.h"
-#include "bgfx.h"
 #include "block.h"
 #include "primitive.h"
+#include "voxel_storage.h"
+#include <array>
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <random>
 #include <string>
@@ -12,6 +15,25 @@
 #include <vector>
 
 namespace vx::gfx {
+    struct IndexRange {
+        u32 start = 0;
+        u32 count = 0;
+    };
+
+    struct ChunkMesh {
+        std::vector<VertexColor> vertices;
+        std::vector<BlockIndexSize> indices;
+
+        // Range of `indices` holding each FaceDirection's faces
+        std::array<IndexRange, kFaceDirections> faceRanges;
+    };
+
+    struct Chunk;
+
+    // Refers to a chunk in memory (see ChunkStorage), ids are only used to persist chunks
+    using ChunkHandle = util::SlotHandle;
+    using ChunkMap = util::SlotMap<Chunk>;
+
     struct Chunk {
         bool isStatic = false;
         bool needsUpdate = true;
@@ -31,30 +53,83 @@ namespace vx::gfx {
         int ytransform;
         int ztransform;
 
-        std::vector<BlockIndexSize> indices;
-        std::vector<VertexColor> geometry;
+        // Block type of every voxel, z is the fastest moving axis (see voxelIndex). Chunks read from .vxc files
+        // view the mapped file until they are edited.
+        VoxelStorage voxels;
+
+        // Mesh of the voxels in chunk space, drawn at the chunk's translation. Shared with every chunk of the same
+        // dimensions and voxels (see shareChunkMesh), so it is replaced rather than edited.
+        std::shared_ptr<const ChunkMesh> mesh;
 
         explicit Chunk(const ivec3 &chunkSize, const vec3 &chunkTranslation = vec3(0, 0, 0),
                        std::string moduleName = "core", std::string _name = "Chunk", bool _isStatic = false,
                        const BlockType &_blockType = BlockType::kDebug);
         Chunk(bool _isStatic, BlockType _blockType, std::string _name, std::string _shaderModule, uuids::uuid _id,
               int _xdim, int _ydim, int _zdim, int _xtransform, int _ytransform, int _ztransform,
-              std::vector<BlockIndexSize> _indices, std::vector<VertexColor> _geometry)
+              VoxelStorage _voxels, std::shared_ptr<const ChunkMesh> _mesh)
             : isStatic(_isStatic), blockType(_blockType), name(std::move(_name)),
               shaderModule(std::move(_shaderModule)), id(_id), xdim(_xdim), ydim(_ydim), zdim(_zdim),
-              xtransform(_xtransform), ytransform(_ytransform), ztransform(_ztransform), indices(std::move(_indices)),
-              geometry(std::move(_geometry)) {}
+              xtransform(_xtransform), ytransform(_ytransform), ztransform(_ztransform), voxels(std::move(_voxels)),
+              mesh(std::move(_mesh)) {}
 
+        /**
+         * Saves the chunk into the project's region file covering it (see Project::writeChunk).
+         */
         void write() const noexcept;
         /**
          * Generates the geometry from the size and translation and block type values.
-         * This is a destructive action.
+         * This is a destructive action, the chunk is not saved until write is called.
          */
         void setGeometry(const ivec3 &chunkSize, const vec3 &chunkTranslation, const BlockType &_blockType);
 
-        auto operator=(const gfx::Chunk &chunk) -> Chunk & = default;
+        /**
+         * Points `mesh` at the mesh of the current voxels, building it unless another chunk already holds it.
+         */
+        void makeGeometry();
+
+        /**
+         * Meshes the voxels on the calling thread if that hasn't happened yet. The renderer meshes chunks read from
+         * .vxc files on the worker pool instead, the first time they are drawn.
+         */
+        void ensureGeometry() {
+            if (mesh == nullptr) { makeGeometry(); }
+        }
+
+        auto dimensions() const -> ivec3 { return {xdim, ydim, zdim}; }
+        auto translation() const -> vec3 { return {xtransform, ytransform, ztransform}; }
+        auto voxelIndex(int x, int y, int z) const -> usize { return (static_cast<usize>(x) * ydim + y) * zdim + z; }
+
+        // Chunks are handed from the loaders to the storage by moving, copies have to be asked for with clone
+        Chunk(Chunk &&) noexcept = default;
+        auto operator=(Chunk &&) noexcept -> Chunk & = default;
+        auto operator=(const Chunk &) -> Chunk & = delete;
+
+        /**
+         * A copy of the chunk, sharing its voxels and mesh until either is edited (see VoxelStorage).
+         */
+        auto clone() const -> Chunk { return Chunk(*this); }
+
         auto operator==(const gfx::Chunk &other) const -> bool;
 
+        /**
+         * Loads a chunk from a .vxc file, or from a legacy XML chunk file so old projects can be migrated.
+         */
         static auto load(const std::filesystem::path &path) -> std::optional<Chunk>;
+
+    private:
+        Chunk(const Chunk &) = default;
     };
+
+    /**
+     * Meshes voxels in chunk space, one cube per voxel. Chunks with the same dimensions and voxels get the same
+     * mesh for as long as any of them holds on to it, so duplicated chunks cost one mesh between them.
+     */
+    auto shareChunkMesh(const VoxelStorage &voxels, const ivec3 &dimensions) -> std::shared_ptr<const ChunkMesh>;
+
+    /**
+     * Fills `indices` with the cube indices for `nBlocks` consecutive 8-vertex blocks, one face direction at a
+     * time so each direction's faces are a single contiguous range.
+     */
+    void makeFaceBucketedIndices(u64 nBlocks, std::vector<BlockIndexSize> &indices,
+                                 std::array<IndexRange, kFaceDirections> &faceRanges);
 }// namespace vx::gfx
@@ -0,0 +1,384 @@
+#include "chunk_file.h"
+#include "../util/bytes.h"
+#include "../util/compression.h"
+#include "../util/mapped_file.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+namespace vx::gfx {
+    using util::getLittleEndian;
+    using util::putLittleEndian;
+
+    auto chunkCodecFromString(const std::string &codec) -> ChunkCodec {
+        for (int ii = 0; ii < kChunkCodecs; ++ii) {
+            if (codec == kAvailableChunkCodecs.at(ii)) { return static_cast<ChunkCodec>(ii); }
+        }
+        return kDefaultChunkCodec;
+    }
+
+    auto chunkCodecToString(ChunkCodec codec) -> std::string {
+        return kAvailableChunkCodecs.at(static_cast<int>(codec));
+    }
+
+    static auto voxelBytes(const VoxelStorage &voxels) -> std::span<const u8> {
+        // BlockType is a single byte, so the voxels need no byte order conversion
+        static_assert(sizeof(BlockType) == 1);
+        return {reinterpret_cast<const u8 *>(voxels.data()), voxels.size()};
+    }
+
+    static auto encodeVoxels(const VoxelStorage &voxels, ChunkCodec codec) -> std::vector<u8> {
+        switch (codec) {
+            case ChunkCodec::kNone:
+                return {voxelBytes(voxels).begin(), voxelBytes(voxels).end()};
+            case ChunkCodec::kRunLength:
+                return util::runLengthEncode(voxelBytes(voxels));
+            case ChunkCodec::kRunLengthLz: {
+                const auto runs = util::runLengthEncode(voxelBytes(voxels));
+                const auto compressed = util::lzCompress(runs);
+
+                std::vector<u8> payload(sizeof(u64));
+                putLittleEndian<u64>(payload.data(), runs.size());
+                payload.insert(payload.end(), compressed.begin(), compressed.end());
+                return payload;
+            }
+        }
+        return {};
+    }
+
+    static auto decodeRuns(std::span<const u8> runs, u64 nVoxels) -> std::optional<std::vector<BlockType>> {
+        // The runs are summed before allocating, so a corrupt count cannot ask for more memory than they describe
+        if (util::runLengthDecodedSize(runs) != nVoxels) { return std::nullopt; }
+
+        std::vector<BlockType> voxels(nVoxels);
+        if (!util::runLengthDecode(runs, {reinterpret_cast<u8 *>(voxels.data()), voxels.size()})) {
+            return std::nullopt;
+        }
+        return voxels;
+    }
+
+    /**
+     * Decodes `nVoxels` voxels, checking the payload can hold that many before allocating them.
+     */
+    static auto decodeVoxels(std::span<const u8> payload, ChunkCodec codec, u64 nVoxels)
+            -> std::optional<std::vector<BlockType>> {
+        switch (codec) {
+            case ChunkCodec::kNone: {
+                if (nVoxels > payload.size()) { return std::nullopt; }
+                const auto *voxels = reinterpret_cast<const BlockType *>(payload.data());
+                return std::vector<BlockType>(voxels, voxels + nVoxels);
+            }
+            case ChunkCodec::kRunLength:
+                return decodeRuns(payload, nVoxels);
+            case ChunkCodec::kRunLengthLz: {
+                if (payload.size() < sizeof(u64)) { return std::nullopt; }
+                const auto runsSize = getLittleEndian<u64>(payload.data());
+                const auto compressed = payload.subspan(sizeof(u64));
+
+                // Runs never take more than two bytes per voxel, nor more than the compressed block can expand to
+                if (runsSize > 2 * nVoxels + sizeof(u64) || runsSize > util::lzDecompressBound(compressed.size())) {
+                    return std::nullopt;
+                }
+                std::vector<u8> runs(runsSize);
+                if (!util::lzDecompress(compressed, runs)) { return std::nullopt; }
+                return decodeRuns(runs, nVoxels);
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * The header, name and shader module of a serialized chunk, nullopt if either string is too long for its u16
+     * length.
+     */
+    static auto encodeMetadata(const Chunk &chunk, ChunkCodec codec, u16 flags) -> std::optional<std::vector<u8>> {
+        static constexpr usize kMaxStringLength = std::numeric_limits<u16>::max();
+        if (chunk.name.size() > kMaxStringLength || chunk.shaderModule.size() > kMaxStringLength) {
+            spdlog::error("Chunk {} has a name or shader module longer than {} bytes", uuids::to_string(chunk.id),
+                          kMaxStringLength);
+            return std::nullopt;
+        }
+
+        std::array<u8, kChunkFileHeaderSize> header{};
+        std::copy(kChunkFileMagic.begin(), kChunkFileMagic.end(), header.begin());
+        putLittleEndian<u16>(&header.at(4), kChunkFileVersion);
+        putLittleEndian<u16>(&header.at(6), flags | (chunk.isStatic ? kChunkFileFlagStatic : 0));
+        header.at(8) = chunk.blockType;
+        header.at(9) = static_cast<u8>(codec);
+
+        const auto identifier = chunk.id.as_bytes();
+        for (usize ii = 0; ii < identifier.size(); ++ii) { header.at(12 + ii) = static_cast<u8>(identifier[ii]); }
+
+        const ivec3 dimensions = chunk.dimensions();
+        const ivec3 transform(chunk.xtransform, chunk.ytransform, chunk.ztransform);
+        for (int axis = 0; axis < 3; ++axis) {
+            putLittleEndian<i32>(&header.at(28 + 4 * axis), dimensions[axis]);
+            putLittleEndian<i32>(&header.at(40 + 4 * axis), transform[axis]);
+        }
+
+        putLittleEndian<u16>(&header.at(52), chunk.name.size());
+        putLittleEndian<u16>(&header.at(54), chunk.shaderModule.size());
+        putLittleEndian<u64>(&header.at(56), chunk.voxels.size());
+
+        std::vector<u8> bytes(header.begin(), header.end());
+        bytes.insert(bytes.end(), chunk.name.begin(), chunk.name.end());
+        bytes.insert(bytes.end(), chunk.shaderModule.begin(), chunk.shaderModule.end());
+        return bytes;
+    }
+
+    auto encodeChunk(const Chunk &chunk, ChunkCodec codec) -> std::optional<std::vector<u8>> {
+        auto bytes = encodeMetadata(chunk, codec, 0);
+        if (!bytes.has_value()) { return std::nullopt; }
+        const auto payload = encodeVoxels(chunk.voxels, codec);
+        bytes->insert(bytes->end(), payload.begin(), payload.end());
+        return bytes;
+    }
+
+    auto encodeChunkBlob(const Chunk &chunk, ChunkCodec codec) -> std::optional<ChunkBlob> {
+        auto metadata = encodeMetadata(chunk, codec, kChunkFileFlagBlob);
+        if (!metadata.has_value()) { return std::nullopt; }
+
+        ChunkBlob blob{std::move(metadata.value()), encodeVoxels(chunk.voxels, codec), {}};
+        blob.hash = util::contentHash(blob.voxels);
+
+        std::array<u8, kChunkBlobHashSize> hash{};
+        putLittleEndian<u64>(hash.data(), blob.hash.low);
+        putLittleEndian<u64>(hash.data() + 8, blob.hash.high);
+        blob.record.insert(blob.record.end(), hash.begin(), hash.end());
+        return blob;
+    }
+
+    static auto hasBlob(std::span<const u8> bytes) -> bool {
+        return bytes.size() >= kChunkFileHeaderSize &&
+               std::equal(kChunkFileMagic.begin(), kChunkFileMagic.end(), bytes.begin()) &&
+               (getLittleEndian<u16>(bytes.data() + 6) & kChunkFileFlagBlob) != 0;
+    }
+
+    auto chunkBlobHash(std::span<const u8> bytes) -> std::optional<util::Hash128> {
+        const usize metadataSize = chunkMetadataSize(bytes);
+        if (!hasBlob(bytes) || bytes.size() < metadataSize) { return std::nullopt; }
+
+        const u8 *hash = bytes.data() + metadataSize - kChunkBlobHashSize;
+        return util::Hash128{getLittleEndian<u64>(hash), getLittleEndian<u64>(hash + 8)};
+    }
+
+    auto attachChunkBlob(std::span<const u8> record, std::span<const u8> voxels) -> std::vector<u8> {
+        if (!hasBlob(record)) { return {record.begin(), record.end()}; }
+
+        const usize metadataSize = chunkMetadataSize(record) - kChunkBlobHashSize;
+        std::vector<u8> bytes;
+        bytes.reserve(metadataSize + voxels.size());
+        bytes.insert(bytes.end(), record.begin(), record.begin() + metadataSize);
+        bytes.insert(bytes.end(), voxels.begin(), voxels.end());
+        putLittleEndian<u16>(bytes.data() + 6, getLittleEndian<u16>(bytes.data() + 6) & ~kChunkFileFlagBlob);
+        return bytes;
+    }
+
+    auto writeChunkFile(const Chunk &chunk, const std::filesystem::path &path, ChunkCodec codec) -> bool {
+        const auto encoded = encodeChunk(chunk, codec);
+        if (!encoded.has_value()) { return false; }
+        const auto &bytes = encoded.value();
+
+        // Written next to the target and renamed over it, so chunks still mapping the old file keep its contents
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        file.close();
+
+        std::error_code error;
+        if (!file || (std::filesystem::rename(temporaryPath, path, error), error)) {
+            spdlog::error("Failed to write chunk file {}", path.string());
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    struct ChunkHeader {
+        bool isStatic;
+        BlockType blockType;
+        ChunkCodec codec;
+        uuids::uuid id;
+        ivec3 dimensions;
+        ivec3 transform;
+        u64 nVoxels;
+        std::string name;
+        std::string shaderModule;
+
+        // Where the encoded voxels start, unless they are in a blob
+        usize voxelsOffset;
+        bool inBlob;
+    };
+
+    auto chunkVoxelCount(const ivec3 &dimensions) -> std::optional<u64> {
+        // Checked one axis at a time, so neither negative dimensions nor the product can wrap the count
+        u64 nVoxels = 1;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (dimensions[axis] <= 0 || static_cast<u64>(dimensions[axis]) > kMaxChunkVoxels / nVoxels) {
+                return std::nullopt;
+            }
+            nVoxels *= dimensions[axis];
+        }
+        return nVoxels;
+    }
+
+    auto chunkMetadataSize(std::span<const u8> bytes) -> usize {
+        if (bytes.size() < kChunkFileHeaderSize) { return kChunkFileHeaderSize; }
+        const usize stringsSize = getLittleEndian<u16>(bytes.data() + 52) + getLittleEndian<u16>(bytes.data() + 54);
+        return kChunkFileHeaderSize + stringsSize + (hasBlob(bytes) ? kChunkBlobHashSize : 0);
+    }
+
+    /**
+     * Parses everything in front of the voxels, which are not looked at.
+     */
+    static auto parseHeader(std::span<const u8> bytes, const std::string &source) -> std::optional<ChunkHeader> {
+        if (bytes.size() < kChunkFileHeaderSize ||
+            !std::equal(kChunkFileMagic.begin(), kChunkFileMagic.end(), bytes.begin())) {
+            spdlog::error("{} is not a serialized chunk", source);
+            return std::nullopt;
+        }
+
+        const u8 *header = bytes.data();
+        const auto version = getLittleEndian<u16>(header + 4);
+        if (version < kMinChunkFileVersion || version > kChunkFileVersion) {
+            spdlog::error("Chunk {} has unsupported version {}", source, version);
+            return std::nullopt;
+        }
+
+        if (header[9] >= kChunkCodecs) {
+            spdlog::error("Chunk {} has unknown codec {}", source, header[9]);
+            return std::nullopt;
+        }
+
+        if (!isBlockType(header[8])) {
+            spdlog::error("Chunk {} has unknown block type {}", source, header[8]);
+            return std::nullopt;
+        }
+
+        ChunkHeader parsed;
+        parsed.isStatic = (getLittleEndian<u16>(header + 6) & kChunkFileFlagStatic) != 0;
+        parsed.inBlob = hasBlob(bytes);
+        parsed.blockType = static_cast<BlockType>(header[8]);
+        parsed.codec = static_cast<ChunkCodec>(header[9]);
+
+        std::array<uuids::uuid::value_type, 16> identifier{};
+        std::copy(header + 12, header + 28, identifier.begin());
+        parsed.id = uuids::uuid(identifier);
+
+        for (int axis = 0; axis < 3; ++axis) {
+            parsed.dimensions[axis] = getLittleEndian<i32>(header + 28 + 4 * axis);
+            parsed.transform[axis] = getLittleEndian<i32>(header + 40 + 4 * axis);
+        }
+
+        const auto dimensionsVoxels = chunkVoxelCount(parsed.dimensions);
+        if (!dimensionsVoxels.has_value()) {
+            spdlog::error("Chunk {} has dimensions {}x{}x{}, which are not between 1 and {} voxels", source,
+                          parsed.dimensions.x, parsed.dimensions.y, parsed.dimensions.z, kMaxChunkVoxels);
+            return std::nullopt;
+        }
+
+        parsed.nVoxels = getLittleEndian<u64>(header + 56);
+        if (parsed.nVoxels != dimensionsVoxels.value()) {
+            spdlog::error("Chunk {} holds {} voxels, which does not match its dimensions", source, parsed.nVoxels);
+            return std::nullopt;
+        }
+
+        const usize nameLength = getLittleEndian<u16>(header + 52);
+        const usize shaderModuleLength = getLittleEndian<u16>(header + 54);
+        parsed.voxelsOffset = chunkMetadataSize(bytes);
+        if (bytes.size() < parsed.voxelsOffset) {
+            spdlog::error("Chunk {} is truncated", source);
+            return std::nullopt;
+        }
+
+        const auto *strings = reinterpret_cast<const char *>(header + kChunkFileHeaderSize);
+        parsed.name.assign(strings, nameLength);
+        parsed.shaderModule.assign(strings + nameLength, shaderModuleLength);
+        return parsed;
+    }
+
+    /**
+     * Decodes the voxels following a parsed header.
+     */
+    static auto parseVoxels(std::span<const u8> bytes, const ChunkHeader &header, const std::string &source)
+            -> std::optional<std::vector<BlockType>> {
+        if (header.inBlob) {
+            spdlog::error("Chunk {} stores its voxels in a blob which was not attached", source);
+            return std::nullopt;
+        }
+
+        auto voxels = decodeVoxels(bytes.subspan(header.voxelsOffset), header.codec, header.nVoxels);
+        if (!voxels.has_value()) {
+            spdlog::error("Chunk {} has corrupt {} voxels", source, chunkCodecToString(header.codec));
+            return std::nullopt;
+        }
+        if (!std::all_of(voxels->begin(), voxels->end(), [](BlockType voxel) { return isBlockType(voxel); })) {
+            spdlog::error("Chunk {} has voxels of unknown block types", source);
+            return std::nullopt;
+        }
+        return voxels;
+    }
+
+    static auto makeChunk(ChunkHeader header, VoxelStorage voxels) -> Chunk {
+        return Chunk(header.isStatic, header.blockType, std::move(header.name), std::move(header.shaderModule),
+                     header.id, header.dimensions.x, header.dimensions.y, header.dimensions.z, header.transform.x,
+                     header.transform.y, header.transform.z, std::move(voxels), {});
+    }
+
+    /**
+     * Parses a chunk from `bytes`. When they lie in `mappedFile`, uncompressed voxels view the mapping instead of
+     * being copied out.
+     */
+    static auto parseChunk(std::span<const u8> bytes, const std::string &source,
+                           const std::shared_ptr<const util::MappedFile> &mappedFile) -> std::optional<Chunk> {
+        auto header = parseHeader(bytes, source);
+        if (!header.has_value()) { return std::nullopt; }
+
+        // Uncompressed voxels stay in the mapped pages, which are only read in when the chunk is meshed. The mesh
+        // itself is built on the worker pool the first time the chunk is drawn (see ChunkRenderer::acquireMesh).
+        if (header->codec == ChunkCodec::kNone && !header->inBlob && mappedFile != nullptr) {
+            // parseHeader already checked voxelsOffset is within the bytes, so the subtraction can't wrap
+            if (header->nVoxels > bytes.size() - header->voxelsOffset) {
+                spdlog::error("Chunk {} is truncated", source);
+                return std::nullopt;
+            }
+            const usize fileOffset = bytes.data() - mappedFile->bytes().data();
+            const usize nVoxels = header->nVoxels;
+            const usize voxelsOffset = fileOffset + header->voxelsOffset;
+            return makeChunk(std::move(header.value()), VoxelStorage::mapped(mappedFile, voxelsOffset, nVoxels));
+        }
+
+        auto voxels = parseVoxels(bytes, header.value(), source);
+        if (!voxels.has_value()) { return std::nullopt; }
+        return makeChunk(std::move(header.value()), std::move(voxels.value()));
+    }
+
+    auto decodeChunkMetadata(std::span<const u8> bytes, const std::string &source) -> std::optional<Chunk> {
+        auto header = parseHeader(bytes, source);
+        if (!header.has_value()) { return std::nullopt; }
+        return makeChunk(std::move(header.value()), {});
+    }
+
+    auto decodeChunkVoxels(std::span<const u8> bytes, const std::string &source)
+            -> std::optional<std::vector<BlockType>> {
+        const auto header = parseHeader(bytes, source);
+        if (!header.has_value()) { return std::nullopt; }
+        return parseVoxels(bytes, header.value(), source);
+    }
+
+    auto decodeChunk(std::span<const u8> bytes, const std::string &source) -> std::optional<Chunk> {
+        return parseChunk(bytes, source, nullptr);
+    }
+
+    auto readChunkFile(const std::filesystem::path &path) -> std::optional<Chunk> {
+        const auto mappedFile = util::MappedFile::open(path);
+        if (mappedFile == nullptr) {
+            spdlog::error("Failed to open chunk file {}", path.string());
+            return std::nullopt;
+        }
+        return parseChunk(mappedFile->bytes(), path.string(), mappedFile);
+    }
+}// namespace vx::gfx
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "../math.h"
+#include "../util/hash.h"
+#include "chunk.h"
+#include <array>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace vx::gfx {
+    /*
+     * Binary chunk file (.vxc), every integer little-endian:
+     *   0  magic "VXC\0"
+     *   4  u16 version
+     *   6  u16 flags, bit 0 is isStatic, bit 1 (version 3) is set when the voxels are stored in a blob
+     *   8  u8  block type
+     *   9  u8  ChunkCodec of the voxels (version 2, reserved and zero in version 1)
+     *  10  2 bytes reserved
+     *  12  16 byte id
+     *  28  i32 x3 dimensions
+     *  40  i32 x3 transform
+     *  52  u16 name length, u16 shader module length
+     *  56  u64 voxel count
+     *  64  name, then shader module (not terminated)
+     *      voxels, one BlockType byte each in Chunk::voxels order, encoded with the codec:
+     *        kNone         raw voxels
+     *        kRunLength    util::runLengthEncode of the voxels
+     *        kRunLengthLz  u64 run-length encoded size, then util::lzCompress of the run-length encoded voxels
+     *      or, with the blob flag, the 16 byte util::contentHash of the encoded voxels (low half first), which are
+     *      stored once in the project's BlobStore however many chunks hold them
+     */
+    static constexpr std::array<char, 4> kChunkFileMagic = {'V', 'X', 'C', '\0'};
+    static constexpr u16 kChunkFileVersion = 3;
+    static constexpr u16 kMinChunkFileVersion = 1;
+    static constexpr usize kChunkFileHeaderSize = 64;
+
+    static constexpr u16 kChunkFileFlagStatic = 1 << 0;
+    static constexpr u16 kChunkFileFlagBlob = 1 << 1;
+    static constexpr usize kChunkBlobHashSize = 16;
+
+    // The editor refuses chunks whose vertices BlockIndexSize cannot index, so a larger voxel count is corrupt
+    static constexpr u64 kMaxChunkVoxels = std::numeric_limits<BlockIndexSize>::max() / kCubeVertices.size();
+
+    /**
+     * The number of voxels in a chunk of the given dimensions, read from a file.
+     * @return The count, or nullopt if a dimension is not positive or the count is above kMaxChunkVoxels
+     */
+    auto chunkVoxelCount(const ivec3 &dimensions) -> std::optional<u64>;
+
+    // Bytes read from the front of each chunk when only its metadata is needed, enough for the header and any
+    // ordinary name and shader module
+    static constexpr usize kChunkMetadataPrefixSize = 256;
+
+    // Run lengths are taken along z, the fastest moving axis of Chunk::voxels, where runs of a block type are longest
+    enum class ChunkCodec : u8 { kNone = 0, kRunLength, kRunLengthLz };
+    static constexpr int kChunkCodecs = 3;
+    inline const std::array<const char *, kChunkCodecs> kAvailableChunkCodecs = {"none", "rle", "rle+lz"};
+    static constexpr ChunkCodec kDefaultChunkCodec = ChunkCodec::kRunLengthLz;
+
+    /**
+     * The codec with the given kAvailableChunkCodecs name, kDefaultChunkCodec if there is none.
+     */
+    auto chunkCodecFromString(const std::string &codec) -> ChunkCodec;
+    auto chunkCodecToString(ChunkCodec codec) -> std::string;
+
+    /**
+     * Serializes a chunk's metadata and voxels in the .vxc layout, the mesh is not stored.
+     * @param {ChunkCodec} codec - How the voxels are compressed
+     * @return The bytes, or nullopt if the name or shader module is too long for its u16 length
+     */
+    auto encodeChunk(const Chunk &chunk, ChunkCodec codec = kDefaultChunkCodec) -> std::optional<std::vector<u8>>;
+
+    struct ChunkBlob {
+        // The chunk's metadata followed by the hash of its voxels
+        std::vector<u8> record;
+
+        // The encoded voxels, identical for every chunk with the same voxels and codec
+        std::vector<u8> voxels;
+        util::Hash128 hash;
+    };
+
+    /**
+     * Serializes a chunk with its voxels split out into a blob, so chunks with the same voxels can share them.
+     * @param {ChunkCodec} codec - How the voxels are compressed
+     * @return The blob, or nullopt if the name or shader module is too long for its u16 length
+     */
+    auto encodeChunkBlob(const Chunk &chunk, ChunkCodec codec = kDefaultChunkCodec) -> std::optional<ChunkBlob>;
+
+    /**
+     * The hash of the blob holding a serialized chunk's voxels, reading no further than chunkMetadataSize.
+     * @return The hash, or nullopt if the voxels are stored inline or the bytes aren't a chunk
+     */
+    auto chunkBlobHash(std::span<const u8> bytes) -> std::optional<util::Hash128>;
+
+    /**
+     * Joins a chunk serialized by encodeChunkBlob with its voxels, giving the bytes encodeChunk would have.
+     */
+    auto attachChunkBlob(std::span<const u8> record, std::span<const u8> voxels) -> std::vector<u8>;
+
+    /**
+     * Parses a chunk serialized by encodeChunk, the chunk owns a copy of its voxels.
+     * @param {std::string} source - Where the bytes came from, for error messages
+     * @return The chunk, or nullopt if the bytes are truncated, corrupt (including block types which don't exist
+     * and dimensions which aren't positive) or of an unknown version
+     */
+    auto decodeChunk(std::span<const u8> bytes, const std::string &source) -> std::optional<Chunk>;
+
+    /**
+     * The number of bytes from the start of a serialized chunk holding its metadata, and its blob hash if it has
+     * one, judged from the header at the front of `bytes`.
+     */
+    auto chunkMetadataSize(std::span<const u8> bytes) -> usize;
+
+    /**
+     * Parses only the metadata at the front of a serialized chunk, which needs chunkMetadataSize bytes, so nothing
+     * past it has to be read. The chunk's voxels are left empty for the caller to attach (see
+     * VoxelStorage::deferred).
+     * @return The chunk, or nullopt if the metadata is truncated, corrupt or of an unknown version
+     */
+    auto decodeChunkMetadata(std::span<const u8> bytes, const std::string &source) -> std::optional<Chunk>;
+
+    /**
+     * Decodes just the voxels of a chunk serialized by encodeChunk.
+     * @return The voxels, or nullopt if the bytes are truncated, corrupt, of an unknown version or still need their
+     * blob attached
+     */
+    auto decodeChunkVoxels(std::span<const u8> bytes, const std::string &source)
+            -> std::optional<std::vector<BlockType>>;
+
+    /**
+     * Writes a chunk's metadata and voxels to a .vxc file, the mesh is not stored.
+     * @param {ChunkCodec} codec - How the voxels are compressed
+     * @return Whether the chunk could be encoded and the whole file was written
+     */
+    auto writeChunkFile(const Chunk &chunk, const std::filesystem::path &path, ChunkCodec codec = kDefaultChunkCodec)
+            -> bool;
+
+    /**
+     * Reads a .vxc file of any version since kMinChunkFileVersion. Uncompressed voxels view the memory mapped file,
+     * copying them only when edited, compressed voxels are decompressed into the chunk. The mesh is left to the
+     * renderer (see ChunkRenderer::render). Mapped voxels are not checked for unknown block types, which would page
+     * them all in, those are drawn as kDebug blocks instead (see knownBlockType).
+     * @return The chunk, or nullopt if the file is missing, truncated, corrupt or of an unknown version
+     */
+    auto readChunkFile(const std::filesystem::path &path) -> std::optional<Chunk>;
+}// namespace vx::gfx
@@ -0,0 +1,115 @@
+#include "chunk_lod.h"
+#include <algorithm>
+#include <cmath>
+
+namespace vx::gfx {
+    static auto downsampledDimensions(const ivec3 &dimensions, int factor) -> ivec3 {
+        return (dimensions + ivec3(factor - 1)) / factor;
+    }
+
+    auto downsampleVoxels(std::span<const BlockType> voxels, const ivec3 &dimensions, int factor)
+            -> std::vector<BlockType> {
+        const ivec3 cells = downsampledDimensions(dimensions, factor);
+        std::vector<BlockType> downsampled;
+        downsampled.reserve(static_cast<usize>(cells.x) * cells.y * cells.z);
+
+        for (int cx = 0; cx < cells.x; ++cx) {
+            for (int cy = 0; cy < cells.y; ++cy) {
+                for (int cz = 0; cz < cells.z; ++cz) {
+                    const ivec3 begin = ivec3(cx, cy, cz) * factor;
+                    const ivec3 end = glm::min(begin + ivec3(factor), dimensions);
+
+                    std::array<int, kBlockTypes> votes{};
+                    for (int xx = begin.x; xx < end.x; ++xx) {
+                        for (int yy = begin.y; yy < end.y; ++yy) {
+                            const usize row = (static_cast<usize>(xx) * dimensions.y + yy) * dimensions.z;
+                            for (int zz = begin.z; zz < end.z; ++zz) { ++votes[knownBlockType(voxels[row + zz])]; }
+                        }
+                    }
+
+                    // Ties go to the lowest block type so the result is deterministic
+                    const auto majority = std::max_element(votes.begin(), votes.end()) - votes.begin();
+                    downsampled.push_back(static_cast<BlockType>(majority));
+                }
+            }
+        }
+
+        return downsampled;
+    }
+
+    auto makeLodMesh(std::span<const BlockType> voxels, const ivec3 &dimensions, const vec3 &translation, int level)
+            -> ChunkMesh {
+        const int factor = 1 << level;
+        const ivec3 cells = downsampledDimensions(dimensions, factor);
+        const auto downsampled = factor == 1 ? std::vector<BlockType>{} : downsampleVoxels(voxels, dimensions, factor);
+        const std::span<const BlockType> cellVoxels = factor == 1 ? voxels : downsampled;
+
+        ChunkMesh mesh;
+        mesh.vertices.reserve(cellVoxels.size() * kCubeVertices.size());
+        for (int cx = 0; cx < cells.x; ++cx) {
+            for (int cy = 0; cy < cells.y; ++cy) {
+                for (int cz = 0; cz < cells.z; ++cz) {
+                    const ivec3 begin = ivec3(cx, cy, cz) * factor;
+                    const vec3 extent = vec3(glm::min(ivec3(factor), dimensions - begin));
+                    const vec3 origin = vec3(begin) + translation;
+
+                    const auto blockType = cellVoxels[(static_cast<usize>(cx) * cells.y + cy) * cells.z + cz];
+                    const vec4 color = makeColorFromBlockType(blockType);
+                    for (const auto &vertex : kCubeVertices) {
+                        mesh.vertices.emplace_back(origin + vertex * extent, color);
+                    }
+                }
+            }
+        }
+
+        makeFaceBucketedIndices(cellVoxels.size(), mesh.indices, mesh.faceRanges);
+        return mesh;
+    }
+
+    auto mergeChunkMeshes(const std::vector<ChunkMesh> &meshes) -> ChunkMesh {
+        ChunkMesh merged;
+
+        usize nVertices = 0;
+        usize nIndices = 0;
+        for (const auto &mesh : meshes) {
+            nVertices += mesh.vertices.size();
+            nIndices += mesh.indices.size();
+        }
+        merged.vertices.reserve(nVertices);
+        merged.indices.reserve(nIndices);
+
+        std::vector<BlockIndexSize> baseVertices;
+        baseVertices.reserve(meshes.size());
+        for (const auto &mesh : meshes) {
+            baseVertices.push_back(merged.vertices.size());
+            merged.vertices.insert(merged.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        }
+
+        for (int direction = 0; direction < kFaceDirections; ++direction) {
+            merged.faceRanges.at(direction).start = merged.indices.size();
+            for (usize ii = 0; ii < meshes.size(); ++ii) {
+                const auto &[start, count] = meshes.at(ii).faceRanges.at(direction);
+                for (u32 jj = start; jj < start + count; ++jj) {
+                    merged.indices.push_back(meshes.at(ii).indices.at(jj) + baseVertices.at(ii));
+                }
+            }
+            merged.faceRanges.at(direction).count = merged.indices.size() - merged.faceRanges.at(direction).start;
+        }
+
+        return merged;
+    }
+
+    auto continuousLodLevel(float pixelsPerUnit) -> float {
+        if (pixelsPerUnit <= 0) { return static_cast<float>(kChunkLodLevels - 1); }
+        return std::log2(kLodTargetCellPixels / pixelsPerUnit);
+    }
+
+    auto selectLodLevel(float continuousLevel, int currentLevel) -> int {
+        int level = std::clamp(currentLevel, 0, kChunkLodLevels - 1);
+        while (level < kChunkLodLevels - 1 && continuousLevel >= static_cast<float>(level + 1) + kLodHysteresis) {
+            ++level;
+        }
+        while (level > 0 && continuousLevel < static_cast<float>(level) - kLodHysteresis) { --level; }
+        return level;
+    }
+}// namespace vx::gfx
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../math.h"
+#include "block.h"
+#include "chunk.h"
+#include "primitive.h"
+#include <array>
+#include <span>
+#include <vector>
+
+namespace vx::gfx {
+    // Level 0 is the full resolution chunk, level n merges 2^n x 2^n x 2^n voxels into one cell.
+    static constexpr int kChunkLodLevels = 4;
+
+    // Target on-screen size of one cell (in pixels) when picking a level of detail.
+    static constexpr float kLodTargetCellPixels = 4.0f;
+
+    // How far (in levels) the projected size has to move past a boundary before the level changes.
+    static constexpr float kLodHysteresis = 0.25f;
+
+    /**
+     * Downsamples voxels by `factor` along every axis, each cell takes the most common block type of the voxels
+     * it covers. Cells on the far edges may cover fewer voxels when the dimensions are not a multiple of `factor`.
+     * @return The voxels of the downsampled grid, laid out like Chunk::voxels
+     */
+    auto downsampleVoxels(std::span<const BlockType> voxels, const ivec3 &dimensions, int factor)
+            -> std::vector<BlockType>;
+
+    /**
+     * Meshes the voxels of a chunk at a level of detail. Every cell becomes one cube, clipped to the chunk bounds
+     * so the silhouette matches the full resolution mesh.
+     */
+    auto makeLodMesh(std::span<const BlockType> voxels, const ivec3 &dimensions, const vec3 &translation, int level)
+            -> ChunkMesh;
+
+    /**
+     * Concatenates meshes into one, keeping the indices bucketed by face direction.
+     */
+    auto mergeChunkMeshes(const std::vector<ChunkMesh> &meshes) -> ChunkMesh;
+
+    /**
+     * The fractional level at which one cell covers kLodTargetCellPixels.
+     * @param {float} pixelsPerUnit - Projected size, in pixels, of one world unit at the chunk's distance
+     */
+    auto continuousLodLevel(float pixelsPerUnit) -> float;
+
+    /**
+     * Picks the level of detail for a continuous level, only leaving `currentLevel` once the continuous level is
+     * kLodHysteresis past the boundary so chunks don't flicker between two levels.
+     */
+    auto selectLodLevel(float continuousLevel, int currentLevel) -> int;
+}// namespace vx::gfx
@@ -1,72 +1,248 @@
 #include "chunk_renderer.h"
 #include "primitive.h"
-// temporary
-#include "../level_editor/project.h"
+#include "../util/thread_pool.h"
+#include <cassert>
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <utility>
 
 namespace vx::gfx {
-    ChunkRenderer::ChunkRenderer() {
-        vertexLayout_.begin()
+    auto makeChunkVertexLayout() -> bgfx::VertexLayout {
+        bgfx::VertexLayout vertexLayout;
+        vertexLayout.begin()
                 .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
                 // Setting attrib to float instead of uint8 allows for vec4 colors
                 .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Float)
                 .end();
+        return vertexLayout;
     }
 
-    void ChunkRenderer::addChunk(const Chunk &chunk) {
-        // Initialize with the size of the chunk memory
-        const auto geometrySize = sizeof(chunk.geometry[0]) * chunk.geometry.size();
-        const auto indicesSize = sizeof(chunk.indices[0]) * chunk.indices.size();
-        const auto vb = bgfx::createDynamicVertexBuffer(geometrySize, vertexLayout_, BGFX_BUFFER_ALLOW_RESIZE);
-        const auto ib = bgfx::createDynamicIndexBuffer(indicesSize, BGFX_BUFFER_INDEX32 | BGFX_BUFFER_ALLOW_RESIZE);
+    auto visibleFaceDirections(const vec3 &minCorner, const vec3 &maxCorner, const vec3 &eye)
+            -> std::array<bool, kFaceDirections> {
+        std::array<bool, kFaceDirections> visible{};
+        for (int axis = 0; axis < 3; ++axis) {
+            visible.at(2 * axis) = eye[axis] > minCorner[axis] + 1;
+            visible.at(2 * axis + 1) = eye[axis] < maxCorner[axis] - 1;
+        }
+        return visible;
+    }
+
+    auto distanceToBounds(const vec3 &minCorner, const vec3 &maxCorner, const vec3 &eye) -> float {
+        return glm::length(eye - glm::clamp(eye, minCorner, maxCorner));
+    }
+
+    void pushVisibleFaces(DrawList &drawList, bgfx::DynamicVertexBufferHandle vertexBuffer,
+                          bgfx::DynamicIndexBufferHandle indexBuffer,
+                          const std::array<IndexRange, kFaceDirections> &faceRanges,
+                          const std::array<bool, kFaceDirections> &visible, const bgfx::ProgramHandle &program,
+                          u64 state, float depth, const vec3 &translation) {
+        const auto pushRange = [&](u32 start, u32 count) {
+            if (count == 0) { return; }
+            DrawCall drawCall;
+            drawCall.sortKey = makeSortKey(0, program, depth, vertexBuffer);
+            drawCall.state = state;
+            drawCall.program = program;
+            drawCall.vertexBuffer = vertexBuffer;
+            drawCall.indexBuffer = indexBuffer;
+            drawCall.firstIndex = start;
+            drawCall.indexCount = count;
+            drawCall.translation = translation;
+            drawList.push(drawCall);
+        };
+
+        u32 rangeStart = 0;
+        u32 rangeCount = 0;
+        for (int direction = 0; direction < kFaceDirections; ++direction) {
+            const auto &[start, count] = faceRanges.at(direction);
+            if (visible.at(direction)) {
+                if (rangeCount == 0) { rangeStart = start; }
+                rangeCount += count;
+            } else {
+                pushRange(rangeStart, rangeCount);
+                rangeCount = 0;
+            }
+        }
+        pushRange(rangeStart, rangeCount);
+    }
 
-        // Insert into the stack of buffers. This keeps the memory alive for usage. We utilize
-        // this down the chain when we want to swap buffers into the frame
-        buffers_.insert({chunk.id, {vb, ib}});
+    ChunkRenderer::ChunkRenderer(BufferPool &bufferPool) : bufferPool_(bufferPool) {}
+
+    void ChunkRenderer::addChunk(ChunkHandle handle) {
+        if (handle.index() >= buffers_.size()) { buffers_.resize(handle.index() + 1); }
+
+        // Buffers are only taken from the pool once the chunk is drawn, so chunks that are never seen cost no GPU
+        // memory
+        auto &chunkBuffers = buffers_.at(handle.index());
+        chunkBuffers = ChunkBuffers{};
+        chunkBuffers.handle = handle;
+        chunkBuffers.drawnIndex = static_cast<u32>(drawn_.size());
+        drawn_.push_back(handle);
     }
 
-    void ChunkRenderer::deleteChunk(const uuids::uuid &chunkIdentifier) {
-        const auto &[vertexBuffer, indexBuffer] = buffers_.at(chunkIdentifier);
+    void ChunkRenderer::deleteChunk(ChunkHandle handle) {
+        auto &chunkBuffers = buffersOf(handle);
 
-        // Destroy the buffer objects
-        bgfx::destroy(vertexBuffer);
-        bgfx::destroy(indexBuffer);
+        // Hand the buffers back to the pool, they are reused once the frames drawing them are done
+        releaseMesh(chunkBuffers);
+        destroyLods(chunkBuffers);
 
-        // Remove this uuid key
-        buffers_.erase(chunkIdentifier);
+        // The last drawn chunk takes the deleted one's place
+        const auto last = drawn_.back();
+        drawn_.at(chunkBuffers.drawnIndex) = last;
+        buffers_.at(last.index()).drawnIndex = chunkBuffers.drawnIndex;
+        drawn_.pop_back();
+        chunkBuffers = ChunkBuffers{};
     }
 
-    void ChunkRenderer::render(const bgfx::ProgramHandle &program) {
+    void ChunkRenderer::render(const bgfx::ProgramHandle &program, const RenderView &view, ChunkMap &chunks,
+                               const std::unordered_set<ChunkHandle> &covered, DrawList &drawList,
+                               ResidencyManager &residency) {
         u64 state = BGFX_STATE_WRITE_MASK | BGFX_STATE_DEPTH_TEST_LESS | BGFX_STATE_MSAA | BGFX_STATE_DEPTH_TEST_LESS;
 
-        for (const auto &[_id, bufferPair] : buffers_) {
-            const auto &[vertexBuffer, indexBuffer] = bufferPair;
-            auto &chunk = level_editor::Project::instance()->getChunkByIdentifier(_id);
+        for (const auto handle : drawn_) {
+            auto &chunkBuffers = buffersOf(handle);
+            auto &chunk = chunks.at(handle);
 
             if (chunk.needsUpdate) {
-                bgfx::update(vertexBuffer, 0,
-                             bgfx::copy(&chunk.geometry[0], chunk.geometry.size() * sizeof(chunk.geometry[0])));
-                bgfx::update(indexBuffer, 0,
-                             bgfx::copy(&chunk.indices[0], chunk.indices.size() * sizeof(chunk.indices[0])));
+                // A build in flight started from the old voxels
+                chunkBuffers.pendingMesh = {};
+
+                // Evicted chunks pick up the new geometry when they are uploaded again
+                if (chunkBuffers.mesh != nullptr) { acquireMesh(chunk, chunkBuffers); }
+
+                // The coarse levels are rebuilt from the new voxels the next time they are needed
+                destroyLods(chunkBuffers);
+                residency.resize(ResidencyKey::chunk(handle), gpuBytes(chunkBuffers));
                 chunk.needsUpdate = false;
             }
 
+            if (covered.contains(handle)) { continue; }
+
+            // Voxels still on disk are read on the worker pool rather than stalling the frame
+            if (!chunk.voxels.isLoaded()) {
+                chunk.voxels.prefetch();
+                continue;
+            }
+
+            const vec3 minCorner = chunk.translation();
+            const vec3 maxCorner = minCorner + vec3(chunk.dimensions());
+            const float distance = distanceToBounds(minCorner, maxCorner, view.eye);
+            const float continuousLevel = distance > 0 ? continuousLodLevel(view.projectionScale / distance) : 0;
+            chunkBuffers.lodLevel = selectLodLevel(continuousLevel, chunkBuffers.lodLevel);
 
-            bgfx::setVertexBuffer(0, vertexBuffer);
-            bgfx::setIndexBuffer(indexBuffer, 0, chunk.indices.size());
+            const int drawnLevel = acquireLod(chunk, chunkBuffers, chunkBuffers.lodLevel);
+            if (drawnLevel == 0) { acquireMesh(chunk, chunkBuffers); }
+            residency.touch(ResidencyKey::chunk(handle), gpuBytes(chunkBuffers));
+            if (drawnLevel == 0 && chunkBuffers.mesh == nullptr) { continue; }
 
-            bgfx::setState(state);
-            bgfx::submit(0, program);
+            // Both the full resolution and the coarse meshes are in chunk space
+            const auto visible = visibleFaceDirections(minCorner, maxCorner, view.eye);
+            if (drawnLevel == 0) {
+                const auto &[mesh, buffers, _users] = meshes_.at(chunkBuffers.mesh);
+                pushVisibleFaces(drawList, buffers.vertexBuffer, buffers.indexBuffer, mesh->faceRanges, visible,
+                                 program, state, distance, minCorner);
+            } else {
+                const auto &lod = chunkBuffers.lods.at(drawnLevel - 1);
+                pushVisibleFaces(drawList, lod.buffers.vertexBuffer, lod.buffers.indexBuffer, lod.faceRanges,
+                                 visible, program, state, distance, minCorner);
+            }
         }
     }
 
     void ChunkRenderer::destroy() {
-        for (const auto &[_id, bufferPair] : buffers_) {
-            const auto &[vertexBuffer, indexBuffer] = bufferPair;
-            bgfx::destroy(vertexBuffer);
-            bgfx::destroy(indexBuffer);
+        // The pool destroys the buffers once every renderer has returned them
+        for (const auto handle : drawn_) {
+            auto &chunkBuffers = buffersOf(handle);
+            releaseMesh(chunkBuffers);
+            destroyLods(chunkBuffers);
+        }
+    }
+
+    void ChunkRenderer::evictChunk(ChunkHandle handle) {
+        auto &chunkBuffers = buffersOf(handle);
+        releaseMesh(chunkBuffers);
+        destroyLods(chunkBuffers);
+    }
+
+    void ChunkRenderer::acquireMesh(Chunk &chunk, ChunkBuffers &chunkBuffers) {
+        if (chunk.mesh == nullptr) {
+            if (!chunkBuffers.pendingMesh.valid()) {
+                chunkBuffers.pendingMesh = util::ThreadPool::instance()->submit(
+                        [voxels = chunk.voxels, dimensions = chunk.dimensions()]() {
+                            return shareChunkMesh(voxels, dimensions);
+                        });
+            }
+            if (!util::isReady(chunkBuffers.pendingMesh)) { return; }
+            chunk.mesh = chunkBuffers.pendingMesh.get();
+        }
+
+        if (chunkBuffers.mesh == chunk.mesh.get()) { return; }
+        releaseMesh(chunkBuffers);
+
+        auto &shared = meshes_[chunk.mesh.get()];
+        if (shared.users++ == 0) {
+            shared.mesh = chunk.mesh;
+            bufferPool_.upload(shared.buffers, shared.mesh->vertices, shared.mesh->indices);
+        }
+        chunkBuffers.mesh = chunk.mesh.get();
+    }
+
+    void ChunkRenderer::releaseMesh(ChunkBuffers &chunkBuffers) {
+        if (chunkBuffers.mesh == nullptr) { return; }
+
+        const auto shared = meshes_.find(chunkBuffers.mesh);
+        if (--shared->second.users == 0) {
+            bufferPool_.release(shared->second.buffers);
+            meshes_.erase(shared);
+        }
+        chunkBuffers.mesh = nullptr;
+    }
+
+    auto ChunkRenderer::buffersOf(ChunkHandle handle) -> ChunkBuffers & {
+        auto &chunkBuffers = buffers_.at(handle.index());
+        assert(chunkBuffers.handle == handle && "Chunk is not drawn by this renderer");
+        return chunkBuffers;
+    }
+
+    void ChunkRenderer::destroyLods(ChunkBuffers &chunkBuffers) {
+        for (auto &lod : chunkBuffers.lods) {
+            bufferPool_.release(lod.buffers);
+
+            // Any build still in flight finishes on its own copy of the voxels and is dropped
+            lod = LodMesh{};
+        }
+    }
+
+    auto ChunkRenderer::gpuBytes(const ChunkBuffers &chunkBuffers) const -> u64 {
+        u64 bytes = 0;
+        if (chunkBuffers.mesh != nullptr) {
+            const auto &shared = meshes_.at(chunkBuffers.mesh);
+            bytes += shared.buffers.gpuBytes() / shared.users;
+        }
+        for (const auto &lod : chunkBuffers.lods) { bytes += lod.buffers.gpuBytes(); }
+        return bytes;
+    }
+
+    auto ChunkRenderer::acquireLod(const Chunk &chunk, ChunkBuffers &chunkBuffers, int level) -> int {
+        if (level == 0) { return 0; }
+
+        auto &lod = chunkBuffers.lods.at(level - 1);
+        if (!lod.ready() && !lod.pendingMesh.valid()) {
+            lod.pendingMesh = util::ThreadPool::instance()->submit(
+                    [voxels = chunk.voxels, dimensions = chunk.dimensions(), level]() {
+                        return makeLodMesh(voxels.span(), dimensions, vec3(0), level);
+                    });
+        }
+
+        if (util::isReady(lod.pendingMesh)) {
+            const auto mesh = lod.pendingMesh.get();
+            bufferPool_.upload(lod.buffers, mesh.vertices, mesh.indices);
+            lod.faceRanges = mesh.faceRanges;
+        }
+
+        for (int fallback = level; fallback > 0; --fallback) {
+            if (chunkBuffers.lods.at(fallback - 1).ready()) { return fallback; }
         }
+        return 0;
     }
 }// namespace vx::gfx
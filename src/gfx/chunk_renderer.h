@@ -2,37 +2,152 @@
 
 #include "../math.h"
 #include "bgfx.h"
+#include "buffer_pool.h"
 #include "chunk.h"
+#include "chunk_lod.h"
+#include "draw_list.h"
+#include "render_view.h"
+#include "residency.h"
 #include <array>
+#include <future>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 namespace vx::gfx {
+    auto makeChunkVertexLayout() -> bgfx::VertexLayout;
+
+    /**
+     * A face direction can only be front-facing if the eye is in front of at least one of that direction's face
+     * planes. Faces of the block at world position p lie on the planes p and p + 1 along their axis.
+     */
+    auto visibleFaceDirections(const vec3 &minCorner, const vec3 &maxCorner, const vec3 &eye)
+            -> std::array<bool, kFaceDirections>;
+
+    /**
+     * Distance from the eye to the closest point of a box, zero when the eye is inside it.
+     */
+    auto distanceToBounds(const vec3 &minCorner, const vec3 &maxCorner, const vec3 &eye) -> float;
+
+    /**
+     * Queues the visible face buckets of a mesh. The buckets are contiguous, so neighbouring visible directions
+     * collapse into one draw.
+     * @param {float} depth - Distance of the mesh from the eye, used to order the draws front-to-back
+     * @param {vec3} translation - Where the mesh is drawn, zero for meshes built in world space
+     */
+    void pushVisibleFaces(DrawList &drawList, bgfx::DynamicVertexBufferHandle vertexBuffer,
+                          bgfx::DynamicIndexBufferHandle indexBuffer,
+                          const std::array<IndexRange, kFaceDirections> &faceRanges,
+                          const std::array<bool, kFaceDirections> &visible, const bgfx::ProgramHandle &program,
+                          u64 state, float depth, const vec3 &translation = vec3(0));
+
     class ChunkRenderer {
     public:
-        ChunkRenderer();
+        /**
+         * @param {BufferPool} bufferPool - Supplies the chunk and level of detail buffers, must outlive the renderer
+         */
+        explicit ChunkRenderer(BufferPool &bufferPool);
 
-        void addChunk(const Chunk &chunk);
+        void addChunk(ChunkHandle handle);
 
         /**
          * Delete a chunk
-         * @param {uuids::uuid} chunkIdentifier - The ID of the chunk we're removing
+         * @param {ChunkHandle} handle - The chunk we're removing
          */
-        void deleteChunk(const uuids::uuid &chunkIdentifier);
+        void deleteChunk(ChunkHandle handle);
 
-        void render(const bgfx::ProgramHandle &program);
+        /**
+         * Queue every chunk at the level of detail matching its projected size, skipping the face directions
+         * which point away from the eye. Every level is meshed on the worker pool the first time it is needed, the
+         * nearest finer level is drawn until it is ready. Chunks whose voxels are still on disk are left out while
+         * the voxels are read.
+         * @param {bgfx::ProgramHandle} program - The shader program to draw the chunks with
+         * @param {RenderView} view - The camera the chunks are drawn from
+         * @param {ChunkMap} chunks - Every chunk of the project, this renderer draws the ones added to it
+         * @param {std::unordered_set<ChunkHandle>} covered - Chunks already drawn by a cluster proxy
+         * @param {DrawList} drawList - Receives the draws, submitted once every renderer is done
+         * @param {ResidencyManager} residency - Told about every chunk drawn and the GPU bytes it holds
+         */
+        void render(const bgfx::ProgramHandle &program, const RenderView &view, ChunkMap &chunks,
+                    const std::unordered_set<ChunkHandle> &covered, DrawList &drawList, ResidencyManager &residency);
         void destroy();
 
-        auto vertexLayout() const -> const bgfx::VertexLayout & { return vertexLayout_; }
+        /**
+         * Returns every buffer of a chunk to the pool. The chunk is uploaded again from its CPU data, or meshed
+         * at the level it needs, the next time it is drawn.
+         */
+        void evictChunk(ChunkHandle handle);
 
     private:
-        struct BufferPair {
-            bgfx::DynamicVertexBufferHandle vertexBuffer;
-            bgfx::DynamicIndexBufferHandle indexBuffer;
+        struct LodMesh {
+            PooledBuffers buffers;
+            std::array<IndexRange, kFaceDirections> faceRanges{};
+
+            // Set while the mesh is being built on the worker pool
+            std::future<ChunkMesh> pendingMesh;
+
+            auto ready() const -> bool { return buffers.valid(); }
+        };
+
+        struct SharedMesh {
+            // Keeps the mesh, and with it the key in meshes_, alive while it is uploaded
+            std::shared_ptr<const ChunkMesh> mesh;
+            PooledBuffers buffers;
+
+            // Resident chunks drawing the mesh
+            u32 users = 0;
+        };
+
+        struct ChunkBuffers {
+            // The chunk the buffers belong to, invalid in the slots of chunks this renderer doesn't draw
+            ChunkHandle handle;
+
+            // Position of the chunk in drawn_
+            u32 drawnIndex = 0;
+
+            // Full resolution mesh, whose buffers in meshes_ are shared with every resident chunk drawing it. Null
+            // while the chunk is not resident.
+            const ChunkMesh *mesh = nullptr;
+
+            // Set while the chunk's full resolution mesh is being built on the worker pool
+            std::future<std::shared_ptr<const ChunkMesh>> pendingMesh;
+
+            // Coarse levels, index n - 1 holds level n
+            std::array<LodMesh, kChunkLodLevels - 1> lods;
+
+            int lodLevel = 0;
         };
 
-        bgfx::VertexLayout vertexLayout_;
-        std::unordered_map<uuids::uuid, BufferPair> buffers_;
+        BufferPool &bufferPool_;
+
+        // Indexed by the slot of each chunk's handle, so looking a chunk up is indexing an array
+        std::vector<ChunkBuffers> buffers_;
+
+        // The chunks this renderer draws, walked every frame
+        std::vector<ChunkHandle> drawn_;
+
+        std::unordered_map<const ChunkMesh *, SharedMesh> meshes_;
+
+        /**
+         * Points the chunk at the buffers of its current mesh, uploading the mesh unless another chunk already did.
+         * A chunk without a mesh has one built on the worker pool, keeping its old buffers, if any, until it's done.
+         */
+        void acquireMesh(Chunk &chunk, ChunkBuffers &chunkBuffers);
+        void releaseMesh(ChunkBuffers &chunkBuffers);
+        auto buffersOf(ChunkHandle handle) -> ChunkBuffers &;
+        void destroyLods(ChunkBuffers &chunkBuffers);
+
+        /**
+         * GPU memory held by a chunk, shared buffers are split evenly between the chunks drawing them.
+         */
+        auto gpuBytes(const ChunkBuffers &chunkBuffers) const -> u64;
+
+        /**
+         * Returns `level` if its mesh is ready, otherwise the nearest finer level that is. Kicks off a build of
+         * `level` if it has not been requested yet.
+         */
+        auto acquireLod(const Chunk &chunk, ChunkBuffers &chunkBuffers, int level) -> int;
     };
 }// namespace vx::gfx
@@ -1,36 +1,90 @@
 #include "chunk_storage.h"
 #include "../paths.h"
 #include "../resources.h"
+#include "../util/thread_pool.h"
+#include <algorithm>
 
 namespace vx::gfx {
-    void ChunkStorage::render() {
-        for (const auto &[moduleName, renderer] : renderers_) { renderer->render(shaderPrograms_.at(moduleName)); }
+    ChunkStorage::ChunkStorage() : clusters_(bufferPool_, residency_) {}
+
+    void ChunkStorage::render(const RenderView &view) {
+        bufferPool_.nextFrame();
+        residency_.nextFrame();
+
+        // Catch edits before the renderers consume them so the proxies of the changed clusters get rebuilt
+        for (usize ii = 0; ii < chunks_.size(); ++ii) {
+            const auto &chunk = chunks_.values().at(ii);
+            if (chunk.needsUpdate) { clusters_.updateChunk(chunks_.handles().at(ii), chunk); }
+        }
+
+        drawList_.clear();
+
+        std::unordered_set<ChunkHandle> covered;
+        clusters_.render(shaderPrograms_, chunks_, view, covered, drawList_);
+
+        for (const auto &[moduleName, renderer] : renderers_) {
+            renderer->render(shaderPrograms_.at(moduleName), view, chunks_, covered, drawList_, residency_);
+        }
+
+        // Free up the least recently drawn chunks and proxies, the pool then lets go of what it can't use again soon
+        for (const auto &evicted : residency_.evict()) {
+            if (evicted.kind == ResidencyKey::Kind::kCluster) {
+                clusters_.evictCluster(evicted.id);
+                continue;
+            }
+            const auto handle = evicted.chunkHandle();
+            renderers_.at(chunks_.at(handle).shaderModule)->evictChunk(handle);
+        }
+        bufferPool_.trim();
+
+        // Group the draws by program and order them front-to-back before handing them to bgfx
+        drawList_.sort();
+        drawList_.submit(&encoderPool_);
+    }
+
+    auto ChunkStorage::hasDirtyChunks() const -> bool {
+        return std::any_of(chunks_.begin(), chunks_.end(), [](const Chunk &chunk) { return chunk.needsUpdate; });
     }
 
     void ChunkStorage::destroy() {
         spdlog::info("Destroying Chunk Storage");
         for (const auto &[_, renderer] : renderers_) { renderer->destroy(); }
+        clusters_.destroy();
+        bufferPool_.destroy();
         for (const auto &[_, program] : shaderPrograms_) { bgfx::destroy(program); }
     }
 
-    void ChunkStorage::addChunk(const Chunk &chunk, bool write) {
-        chunks_.insert({chunk.id, chunk});
-        if (write) { chunk.write(); }
+    auto ChunkStorage::addChunk(Chunk &&chunk, bool write) -> ChunkHandle {
+        const auto handle = chunks_.insert(std::move(chunk));
+        if (write) { chunks_.at(handle).write(); }
+        registerChunk(handle);
+        return handle;
+    }
+
+    void ChunkStorage::addChunks(std::vector<Chunk> chunks) {
+        chunks_.reserve(chunks_.size() + chunks.size());
+        for (auto &chunk : chunks) { addChunk(std::move(chunk), false); }
+    }
+
+    void ChunkStorage::registerChunk(ChunkHandle handle) {
+        const auto &chunk = chunks_.at(handle);
 
         // Add the chunk to the shader programs if it's not already there
         if (shaderPrograms_.find(chunk.shaderModule) == shaderPrograms_.end()) {
             shaderPrograms_.insert(
                     {chunk.shaderModule, vx::loadShaderProgram(paths::kShadersPath, chunk.shaderModule)});
-            renderers_.insert({chunk.shaderModule, std::make_unique<ChunkRenderer>()});
+            renderers_.insert({chunk.shaderModule, std::make_unique<ChunkRenderer>(bufferPool_)});
         }
 
         // Now, add the chunk to the appropriate renderer
-        renderers_.at(chunk.shaderModule)->addChunk(chunk);
+        renderers_.at(chunk.shaderModule)->addChunk(handle);
+        clusters_.addChunk(handle, chunk);
     }
 
-    void ChunkStorage::deleteChunk(const uuids::uuid &chunkIdentifier) {
-        const auto &chunk = chunks_.at(chunkIdentifier);
-        renderers_.at(chunk.shaderModule)->deleteChunk(chunk.id);
-        chunks_.erase(chunkIdentifier);
+    void ChunkStorage::deleteChunk(ChunkHandle handle) {
+        renderers_.at(chunks_.at(handle).shaderModule)->deleteChunk(handle);
+        clusters_.deleteChunk(handle);
+        residency_.erase(ResidencyKey::chunk(handle));
+        chunks_.erase(handle);
     }
 }// namespace vx::gfx
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "bgfx.h"
+#include "buffer_pool.h"
 #include "chunk.h"
 #include "chunk_renderer.h"
+#include "draw_list.h"
+#include "hlod.h"
+#include "render_view.h"
+#include "residency.h"
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -10,17 +15,61 @@
 namespace vx::gfx {
     class ChunkStorage {
     public:
-        void render();
+        ChunkStorage();
+
+        void render(const RenderView &view);
         void destroy();
-        void addChunk(const Chunk &chunk, bool write = true);
-        void deleteChunk(const uuids::uuid &chunkIdentifier);
+        /**
+         * Takes ownership of a chunk and registers it for rendering.
+         * @param {bool} write - Whether to save the chunk to the project
+         * @return The handle the chunk is referred to by while it is in memory
+         */
+        auto addChunk(Chunk &&chunk, bool write = true) -> ChunkHandle;
+
+        /**
+         * Takes ownership of a batch of loaded chunks and registers them for rendering, without saving them.
+         */
+        void addChunks(std::vector<Chunk> chunks);
+        void deleteChunk(ChunkHandle handle);
+
+        auto chunks() -> ChunkMap & { return chunks_; }
+        auto chunks() const -> const ChunkMap & { return chunks_; }
+        /**
+         * Whether any chunk has edits its renderer has not uploaded yet.
+         */
+        auto hasDirtyChunks() const -> bool;
 
-        auto chunks() -> std::unordered_map<uuids::uuid, Chunk> & { return chunks_; }
-        auto chunks() const -> const std::unordered_map<uuids::uuid, Chunk> & { return chunks_; }
+        /**
+         * GPU bytes the chunk buffers may hold before the least recently drawn chunks are evicted.
+         */
+        void setGpuBudget(u64 budgetBytes) { residency_.setBudget(budgetBytes); }
+        auto residency() const -> const ResidencyManager & { return residency_; }
+
+        auto drawStats() const -> const DrawListStats & { return drawList_.stats(); }
+        auto bufferPoolStats() const -> const BufferPoolStats & { return bufferPool_.stats(); }
 
     private:
+        // Declared first, the renderers and clusters hold on to it
+        BufferPool bufferPool_;
+
         std::unordered_map<std::string, std::unique_ptr<ChunkRenderer>> renderers_;
-        std::unordered_map<uuids::uuid, Chunk> chunks_;
+        ChunkMap chunks_;
         std::unordered_map<std::string, bgfx::ProgramHandle> shaderPrograms_;
+
+        // Declared before the clusters, which charge their proxies to it
+        ResidencyManager residency_;
+        HlodClusters clusters_;
+
+        // Kept between frames so its storage is reused
+        DrawList drawList_;
+
+        // Records draw list slices and nothing else, so submission never queues behind meshing or I/O on the shared
+        // pool
+        util::ThreadPool encoderPool_{kMaxSubmitSlices - 1};
+
+        /**
+         * Hands a chunk already in chunks_ to its renderer and the clusters, loading its shader program if needed.
+         */
+        void registerChunk(ChunkHandle handle);
     };
 }// namespace vx::gfx
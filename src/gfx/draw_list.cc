@@ -0,0 +1,116 @@
+#include "draw_list.h"
+#include "../util/timer.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace vx::gfx {
+    static constexpr int kRadixBits = 8;
+    static constexpr int kRadixBuckets = 1 << kRadixBits;
+    static constexpr int kRadixPasses = 64 / kRadixBits;
+
+    auto makeSortKey(bgfx::ViewId view, bgfx::ProgramHandle program, float depth,
+                     bgfx::DynamicVertexBufferHandle vertexBuffer) -> u64 {
+        // Non-negative IEEE floats order the same as their bit patterns
+        const u64 depthBucket = std::bit_cast<u32>(std::max(depth, 0.0f)) >> 8;
+        return (static_cast<u64>(view & 0xff) << kSortKeyViewShift) |
+               (static_cast<u64>(program.idx & 0xfff) << kSortKeyProgramShift) |
+               (depthBucket << kSortKeyDepthShift) | (static_cast<u64>(vertexBuffer.idx) << kSortKeyBufferShift);
+    }
+
+    void radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch) {
+        scratch.resize(entries.size());
+
+        // Count every digit up front so passes that would not move anything can be skipped
+        std::array<std::array<u32, kRadixBuckets>, kRadixPasses> histograms{};
+        for (const auto &entry : entries) {
+            for (int pass = 0; pass < kRadixPasses; ++pass) {
+                ++histograms.at(pass).at((entry.key >> (pass * kRadixBits)) & (kRadixBuckets - 1));
+            }
+        }
+
+        for (int pass = 0; pass < kRadixPasses; ++pass) {
+            auto &histogram = histograms.at(pass);
+            const u64 firstDigit = entries.empty() ? 0 : (entries.front().key >> (pass * kRadixBits)) & 0xff;
+            if (histogram.at(firstDigit) == entries.size()) { continue; }
+
+            // Turn the counts into the first output slot of each bucket
+            u32 offset = 0;
+            for (auto &count : histogram) {
+                const u32 bucketSize = count;
+                count = offset;
+                offset += bucketSize;
+            }
+
+            for (const auto &entry : entries) {
+                scratch.at(histogram.at((entry.key >> (pass * kRadixBits)) & (kRadixBuckets - 1))++) = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+
+    void DrawList::clear() {
+        stats_ = {};
+        draws_.clear();
+        order_.clear();
+    }
+
+    void DrawList::sort() {
+        util::Timer timer;
+        timer.start();
+
+        order_.resize(draws_.size());
+        for (u32 ii = 0; ii < draws_.size(); ++ii) { order_.at(ii) = {draws_.at(ii).sortKey, ii}; }
+        radixSort(order_, scratch_);
+
+        stats_.draws = draws_.size();
+        stats_.sortMilliseconds = timer.elapsed() * 1000.0;
+    }
+
+    void DrawList::submit(util::ThreadPool *pool) {
+        const usize maxSlices = pool == nullptr ? 1 : std::min<usize>(kMaxSubmitSlices, pool->size() + 1);
+        const usize nSlices = std::clamp<usize>(order_.size() / kMinDrawsPerSlice, 1, maxSlices);
+        const usize sliceSize = (order_.size() + nSlices - 1) / nSlices;
+        const auto sliceBegin = [&](usize slice) { return std::min(slice * sliceSize, order_.size()); };
+
+        // Slice 0 goes on the calling thread's encoder, the rest are recorded on the workers in the meantime
+        std::vector<std::future<bool>> recorded;
+        for (usize slice = 1; slice < nSlices; ++slice) {
+            recorded.push_back(pool->submit([this, slice, begin = sliceBegin(slice), end = sliceBegin(slice + 1)]() {
+                auto *encoder = bgfx::begin(true);
+
+                // Every encoder bgfx was configured with is taken, the caller records this slice instead
+                if (encoder == nullptr) { return false; }
+                submitSlice(encoder, begin, end, slice);
+                bgfx::end(encoder);
+                return true;
+            }));
+        }
+
+        auto *encoder = bgfx::begin();
+        submitSlice(encoder, 0, sliceBegin(1), 0);
+
+        stats_.encoders = 1;
+        for (usize slice = 1; slice < nSlices; ++slice) {
+            if (recorded.at(slice - 1).get()) {
+                ++stats_.encoders;
+            } else {
+                submitSlice(encoder, sliceBegin(slice), sliceBegin(slice + 1), slice);
+            }
+        }
+        bgfx::end(encoder);
+    }
+
+    void DrawList::submitSlice(bgfx::Encoder *encoder, usize begin, usize end, bgfx::ViewId slice) const {
+        for (usize ii = begin; ii < end; ++ii) {
+            const auto &drawCall = draws_.at(order_.at(ii).index);
+            const mat4 model = glm::translate(mat4(1.0f), drawCall.translation);
+            encoder->setTransform(glm::value_ptr(model));
+            encoder->setVertexBuffer(0, drawCall.vertexBuffer);
+            encoder->setIndexBuffer(drawCall.indexBuffer, drawCall.firstIndex, drawCall.indexCount);
+
+            encoder->setState(drawCall.state);
+            encoder->submit(drawCall.view + slice, drawCall.program);
+        }
+    }
+}// namespace vx::gfx
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../math.h"
+#include "../util/thread_pool.h"
+#include "bgfx.h"
+#include <vector>
+
+namespace vx::gfx {
+    /*
+     * Sort key layout, most significant bits first:
+     *  63..56 view
+     *  55..44 program
+     *  43..20 depth bucket, top 24 bits of the (non-negative) float distance to the eye so nearer draws go first
+     *  19..4  vertex buffer
+     *   3..0  unused
+     */
+    static constexpr int kSortKeyViewShift = 56;
+    static constexpr int kSortKeyProgramShift = 44;
+    static constexpr int kSortKeyDepthShift = 20;
+    static constexpr int kSortKeyBufferShift = 4;
+
+    /*
+     * Parallel submission splits the sorted list into contiguous slices, each recorded on its own encoder into its
+     * own view (draw view + slice). Views execute in id order, so the slices keep their relative order even though
+     * they are recorded concurrently. The views after the first must be set up like it, minus the clear.
+     */
+    static constexpr int kMaxSubmitSlices = 4;
+    static constexpr u32 kMinDrawsPerSlice = 256;
+
+    auto makeSortKey(bgfx::ViewId view, bgfx::ProgramHandle program, float depth,
+                     bgfx::DynamicVertexBufferHandle vertexBuffer) -> u64;
+
+    struct DrawCall {
+        u64 sortKey = 0;
+        u64 state = 0;
+
+        bgfx::ViewId view = 0;
+        bgfx::ProgramHandle program = BGFX_INVALID_HANDLE;
+        bgfx::DynamicVertexBufferHandle vertexBuffer = BGFX_INVALID_HANDLE;
+        bgfx::DynamicIndexBufferHandle indexBuffer = BGFX_INVALID_HANDLE;
+
+        u32 firstIndex = 0;
+        u32 indexCount = 0;
+
+        // Meshes are built in chunk space and shared between chunks, each draw places its mesh in the world
+        vec3 translation = vec3(0);
+    };
+
+    struct DrawListStats {
+        u32 draws = 0;
+
+        // Encoders the last submission was recorded on
+        u32 encoders = 0;
+
+        f64 sortMilliseconds = 0;
+    };
+
+    /**
+     * Entry sorted in place of the (much larger) draw call it points at.
+     */
+    struct SortEntry {
+        u64 key;
+        u32 index;
+    };
+
+    /**
+     * LSD radix sort on 8 bit digits, stable. Passes where every key shares the digit are skipped, which is the
+     * common case for the view and unused bits.
+     * @param {std::vector<SortEntry>} scratch - Reused between calls to avoid reallocating every frame
+     */
+    void radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch);
+
+    /**
+     * The visible draws of one frame. Draws are collected in any order and submitted in sort key order so state
+     * changes are grouped by program and opaque geometry goes front-to-back for early depth rejection.
+     */
+    class DrawList {
+    public:
+        void clear();
+        void push(const DrawCall &drawCall) { draws_.push_back(drawCall); }
+
+        void sort();
+
+        /**
+         * Records the sorted draws. With a pool, lists of at least 2 * kMinDrawsPerSlice draws are split across
+         * the pool's workers and the calling thread, this blocks until every slice is recorded. The pool should run
+         * nothing else, or the frame waits behind whatever was queued before the slices.
+         * @param {util::ThreadPool} pool - Workers to record on, nullptr records everything on the calling thread
+         */
+        void submit(util::ThreadPool *pool = nullptr);
+
+        auto draws() const -> const std::vector<DrawCall> & { return draws_; }
+        auto order() const -> const std::vector<SortEntry> & { return order_; }
+        auto stats() const -> const DrawListStats & { return stats_; }
+
+    private:
+        DrawListStats stats_;
+
+        std::vector<DrawCall> draws_;
+        std::vector<SortEntry> order_;
+        std::vector<SortEntry> scratch_;
+
+        /**
+         * Records order_[begin, end) into `view` + `slice` of each draw.
+         */
+        void submitSlice(bgfx::Encoder *encoder, usize begin, usize end, bgfx::ViewId slice) const;
+    };
+}// namespace vx::gfx
@@ -0,0 +1,31 @@
+#include "frame_pacer.h"
+#include <algorithm>
+
+namespace vx::gfx {
+    void FramePacer::requestFrames(u32 nFrames) { pendingFrames_ = std::max(pendingFrames_, nFrames); }
+
+    void FramePacer::observeCamera(const mat4 &viewMatrix) {
+        if (viewMatrix != viewMatrix_) {
+            viewMatrix_ = viewMatrix;
+            requestFrames();
+        }
+    }
+
+    void FramePacer::observeJobs(usize activeJobs) {
+        if (activeJobs != activeJobs_) {
+            activeJobs_ = activeJobs;
+            requestFrames();
+        }
+    }
+
+    auto FramePacer::waitSeconds() const -> f64 {
+        if (pendingFrames_ > 0) { return 0; }
+        return activeJobs_ > 0 ? kBusyWaitSeconds : kIdleWaitSeconds;
+    }
+
+    auto FramePacer::beginFrame() -> bool {
+        if (pendingFrames_ == 0) { return false; }
+        --pendingFrames_;
+        return true;
+    }
+}// namespace vx::gfx
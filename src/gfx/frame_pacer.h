@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../math.h"
+
+namespace vx::gfx {
+    // Frames drawn after any activity, ImGui needs a few to settle hover and layout state
+    static constexpr u32 kActivityFrames = 3;
+
+    // How long the event wait may block while background jobs run, their results are picked up by a frame
+    static constexpr f64 kBusyWaitSeconds = 1.0 / 60.0;
+
+    // How long the event wait may block when nothing at all is happening
+    static constexpr f64 kIdleWaitSeconds = 0.5;
+
+    /**
+     * Decides which frames the editor draws when rendering on demand. Any trigger (input, a camera move, a dirty
+     * chunk, a finished background job or a running animation) schedules kActivityFrames frames, otherwise the
+     * loop sleeps in the event wait.
+     */
+    class FramePacer {
+    public:
+        /**
+         * Schedules frames for input and other explicit triggers.
+         */
+        void requestFrames(u32 nFrames = kActivityFrames);
+
+        void observeCamera(const mat4 &viewMatrix);
+
+        /**
+         * Jobs in flight are polled for results while rendering, so a change in their number needs a frame.
+         */
+        void observeJobs(usize activeJobs);
+
+        /**
+         * Seconds the event wait may block before the next frame decision.
+         */
+        auto waitSeconds() const -> f64;
+
+        /**
+         * Consumes a scheduled frame.
+         * @return Whether a frame should be drawn now
+         */
+        auto beginFrame() -> bool;
+
+    private:
+        u32 pendingFrames_ = kActivityFrames;
+        usize activeJobs_ = 0;
+        mat4 viewMatrix_ = mat4(0.0f);
+    };
+}// namespace vx::gfx
@@ -0,0 +1,125 @@
+#include "hlod.h"
+#include "../util/thread_pool.h"
+#include "chunk_renderer.h"
+#include <spdlog/spdlog.h>
+#include <tuple>
+
+namespace vx::gfx {
+    HlodClusters::HlodClusters(BufferPool &bufferPool, ResidencyManager &residency)
+        : bufferPool_(bufferPool), residency_(residency) {}
+
+    void HlodClusters::addChunk(ChunkHandle handle, const Chunk &chunk) {
+        const auto key = clusterKeyOf(chunk);
+        auto [entry, inserted] = clusters_.try_emplace(key);
+        auto &cluster = entry->second;
+        if (inserted) {
+            cluster.id = nextClusterId_++;
+            clusterIds_.insert({cluster.id, key});
+        }
+        cluster.members.insert(handle);
+        invalidate(cluster);
+        chunkClusters_.insert({handle, key});
+    }
+
+    void HlodClusters::deleteChunk(ChunkHandle handle) {
+        const auto key = chunkClusters_.at(handle);
+        auto &cluster = clusters_.at(key);
+        cluster.members.erase(handle);
+        invalidate(cluster);
+        if (cluster.members.empty()) {
+            clusterIds_.erase(cluster.id);
+            clusters_.erase(key);
+        }
+
+        chunkClusters_.erase(handle);
+    }
+
+    void HlodClusters::updateChunk(ChunkHandle handle, const Chunk &chunk) {
+        if (clusterKeyOf(chunk) == chunkClusters_.at(handle)) {
+            invalidate(clusters_.at(chunkClusters_.at(handle)));
+            return;
+        }
+
+        // The chunk moved (or changed module), re-home it
+        deleteChunk(handle);
+        addChunk(handle, chunk);
+    }
+
+    void HlodClusters::render(const std::unordered_map<std::string, bgfx::ProgramHandle> &programs,
+                              const ChunkMap &chunks, const RenderView &view, std::unordered_set<ChunkHandle> &covered,
+                              DrawList &drawList) {
+        u64 state = BGFX_STATE_WRITE_MASK | BGFX_STATE_DEPTH_TEST_LESS | BGFX_STATE_MSAA;
+
+        for (auto &[key, cluster] : clusters_) {
+            vec3 minCorner(kFloatMax);
+            vec3 maxCorner(-kFloatMax);
+            for (const auto &member : cluster.members) {
+                const auto &chunk = chunks.at(member);
+                minCorner = glm::min(minCorner, chunk.translation());
+                maxCorner = glm::max(maxCorner, chunk.translation() + vec3(chunk.dimensions()));
+            }
+
+            const float distance = distanceToBounds(minCorner, maxCorner, view.eye);
+            const auto program = programs.find(key.shaderModule);
+            if (distance <= kHlodDistance || program == programs.end()) { continue; }
+
+            if (!cluster.ready() && !cluster.pendingMesh.valid()) { requestProxy(cluster, chunks); }
+
+            if (util::isReady(cluster.pendingMesh)) {
+                const auto mesh = cluster.pendingMesh.get();
+                bufferPool_.upload(cluster.buffers, mesh.vertices, mesh.indices);
+                cluster.faceRanges = mesh.faceRanges;
+            }
+
+            if (!cluster.ready()) { continue; }
+
+            pushVisibleFaces(drawList, cluster.buffers.vertexBuffer, cluster.buffers.indexBuffer,
+                             cluster.faceRanges, visibleFaceDirections(minCorner, maxCorner, view.eye),
+                             program->second, state, distance);
+            residency_.touch(ResidencyKey::cluster(cluster.id), cluster.buffers.gpuBytes());
+            covered.insert(cluster.members.begin(), cluster.members.end());
+        }
+    }
+
+    void HlodClusters::destroy() {
+        for (auto &[_key, cluster] : clusters_) { invalidate(cluster); }
+    }
+
+    void HlodClusters::evictCluster(u32 id) {
+        const auto key = clusterIds_.find(id);
+        if (key != clusterIds_.end()) { invalidate(clusters_.at(key->second)); }
+    }
+
+    auto HlodClusters::clusterKeyOf(const Chunk &chunk) -> ClusterKey {
+        const ivec3 cell = ivec3(glm::floor(chunk.translation() / static_cast<float>(kHlodClusterExtent)));
+        return {chunk.shaderModule, cell};
+    }
+
+    void HlodClusters::invalidate(Cluster &cluster) {
+        bufferPool_.release(cluster.buffers);
+        residency_.erase(ResidencyKey::cluster(cluster.id));
+
+        // A build still in flight was started from the old members, drop its result
+        cluster.pendingMesh = {};
+    }
+
+    void HlodClusters::requestProxy(Cluster &cluster, const ChunkMap &chunks) {
+        // The worker gets its own copy of the member voxels so edits on the main thread can't race it, copies of
+        // mapped voxels only share the mapping
+        std::vector<std::tuple<VoxelStorage, ivec3, vec3>> members;
+        members.reserve(cluster.members.size());
+        for (const auto &member : cluster.members) {
+            const auto &chunk = chunks.at(member);
+            members.emplace_back(chunk.voxels, chunk.dimensions(), chunk.translation());
+        }
+
+        cluster.pendingMesh = util::ThreadPool::instance()->submit([members = std::move(members)]() {
+            std::vector<ChunkMesh> meshes;
+            meshes.reserve(members.size());
+            for (const auto &[voxels, dimensions, translation] : members) {
+                meshes.push_back(makeLodMesh(voxels.span(), dimensions, translation, kChunkLodLevels - 1));
+            }
+            return mergeChunkMeshes(meshes);
+        });
+    }
+}// namespace vx::gfx
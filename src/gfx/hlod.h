@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../math.h"
+#include "bgfx.h"
+#include "buffer_pool.h"
+#include "chunk.h"
+#include "chunk_lod.h"
+#include "draw_list.h"
+#include "render_view.h"
+#include "residency.h"
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace vx::gfx {
+    // Clusters span this many nominal chunk edges along every axis
+    static constexpr int kHlodClusterChunks = 4;
+    static constexpr int kHlodReferenceChunkSize = 32;
+    static constexpr int kHlodClusterExtent = kHlodClusterChunks * kHlodReferenceChunkSize;
+
+    // Clusters whose bounds are farther than this from the eye are drawn as a single proxy mesh
+    static constexpr float kHlodDistance = 384.0f;
+
+    struct ClusterKey {
+        std::string shaderModule;
+        ivec3 cell;
+
+        auto operator==(const ClusterKey &other) const -> bool {
+            return shaderModule == other.shaderModule && cell == other.cell;
+        }
+    };
+
+    struct ClusterKeyHash {
+        auto operator()(const ClusterKey &key) const -> usize {
+            usize seed = std::hash<std::string>{}(key.shaderModule);
+            for (int axis = 0; axis < 3; ++axis) { seed = seed * 31 + std::hash<int>{}(key.cell[axis]); }
+            return seed;
+        }
+    };
+
+    /**
+     * Groups spatially adjacent chunks of the same shader module into clusters on a grid of kHlodClusterExtent
+     * cells. Each cluster owns one merged mesh of its members' coarsest level of detail which is drawn in place of
+     * the members once the whole cluster is beyond kHlodDistance. Proxies are charged to the GPU budget like chunks,
+     * under their cluster's id.
+     */
+    class HlodClusters {
+    public:
+        HlodClusters(BufferPool &bufferPool, ResidencyManager &residency);
+
+        void addChunk(ChunkHandle handle, const Chunk &chunk);
+        void deleteChunk(ChunkHandle handle);
+
+        /**
+         * Marks the chunk's cluster for a rebuild, moving the chunk between clusters if its transform changed.
+         */
+        void updateChunk(ChunkHandle handle, const Chunk &chunk);
+
+        /**
+         * Queues the proxies of far clusters. Proxies are (re)built on the worker pool the first time a cluster
+         * is far away after a change, its members are drawn individually until then.
+         * @param {std::unordered_set<ChunkHandle>} covered - Filled with the chunks drawn through a proxy
+         */
+        void render(const std::unordered_map<std::string, bgfx::ProgramHandle> &programs, const ChunkMap &chunks,
+                    const RenderView &view, std::unordered_set<ChunkHandle> &covered, DrawList &drawList);
+        void destroy();
+
+        /**
+         * Frees the proxy of a cluster picked by the ResidencyManager, it is rebuilt the next time it is far away.
+         */
+        void evictCluster(u32 id);
+
+    private:
+        struct Cluster {
+            // Identifies the cluster to the ResidencyManager, ClusterKeys are too large to key it
+            u32 id = 0;
+            std::unordered_set<ChunkHandle> members;
+
+            PooledBuffers buffers;
+            std::array<IndexRange, kFaceDirections> faceRanges{};
+
+            // Set while the proxy is being built on the worker pool
+            std::future<ChunkMesh> pendingMesh;
+
+            auto ready() const -> bool { return buffers.valid(); }
+        };
+
+        BufferPool &bufferPool_;
+        ResidencyManager &residency_;
+        std::unordered_map<ClusterKey, Cluster, ClusterKeyHash> clusters_;
+        std::unordered_map<ChunkHandle, ClusterKey> chunkClusters_;
+        std::unordered_map<u32, ClusterKey> clusterIds_;
+        u32 nextClusterId_ = 0;
+
+        static auto clusterKeyOf(const Chunk &chunk) -> ClusterKey;
+
+        void invalidate(Cluster &cluster);
+        void requestProxy(Cluster &cluster, const ChunkMap &chunks);
+    };
+}// namespace vx::gfx
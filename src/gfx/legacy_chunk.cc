@@ -0,0 +1,245 @@
+#include "legacy_chunk.h"
+#include "chunk_file.h"
+#include "../level_editor/project_version.h"
+#include "../util/mapped_file.h"
+#include "../util/strings.h"
+#include <charconv>
+#include <cstring>
+#include <pugixml.hpp>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+namespace vx::gfx {
+    /**
+     * Where the element opened at `open` ends, just past its closing tag.
+     */
+    static auto elementEnd(std::string_view xml, usize open, std::string_view closingTag) -> usize {
+        const usize tagEnd = xml.find('>', open);
+        if (tagEnd == std::string_view::npos) { return std::string_view::npos; }
+
+        // Empty lists are written as a self-closing tag
+        if (xml.at(tagEnd - 1) == '/') { return tagEnd + 1; }
+
+        const usize close = xml.find(closingTag, tagEnd);
+        return close == std::string_view::npos ? close : close + closingTag.size();
+    }
+
+    auto stripLegacyChunkLists(std::string_view xml) -> std::optional<std::string> {
+        const usize indicesOpen = xml.find("<indices-list");
+        if (indicesOpen == std::string_view::npos) { return std::nullopt; }
+        const usize indicesEnd = elementEnd(xml, indicesOpen, "</indices-list>");
+        if (indicesEnd == std::string_view::npos) { return std::nullopt; }
+
+        // The vertex list is the last thing in the file, only the tags closing it are kept
+        const usize verticesOpen = xml.find("<vertices-list", indicesEnd);
+        if (verticesOpen == std::string_view::npos) { return std::nullopt; }
+
+        std::string stripped;
+        stripped.reserve(indicesOpen + (verticesOpen - indicesEnd) + 32);
+        stripped.append(xml.substr(0, indicesOpen));
+        stripped.append(xml.substr(indicesEnd, verticesOpen - indicesEnd));
+        stripped.append("</component></project>");
+        return stripped;
+    }
+
+    /**
+     * The attribute's value as a number, nullopt unless the whole value is one.
+     */
+    template<typename T>
+    static auto parseNumber(const pugi::xml_attribute &attribute) -> std::optional<T> {
+        const char *text = attribute.value();
+        const char *end = text + std::strlen(text);
+        T value{};
+        const auto [parsedEnd, error] = std::from_chars(text, end, value);
+        if (error != std::errc() || parsedEnd != end) { return std::nullopt; }
+        return value;
+    }
+
+    /**
+     * Reads the entries of a dimensions or transform map, keyed by an x, y or z followed by `suffix`. Missing
+     * entries are left at zero.
+     * @return The values, or nullopt if an entry's value is not a number
+     */
+    static auto parseMap(const pugi::xml_node &component, const char *suffix) -> std::optional<ivec3> {
+        ivec3 values(0);
+        for (const auto &entry : component.child("map").children()) {
+            const char *key = entry.attribute("key").value();
+            if (key[0] < 'x' || key[0] > 'z' || std::strcmp(key + 1, suffix) != 0) { continue; }
+
+            const auto value = parseNumber<int>(entry.attribute("value"));
+            if (!value.has_value()) { return std::nullopt; }
+            values[key[0] - 'x'] = value.value();
+        }
+        return values;
+    }
+
+    /**
+     * The block type written by blockTypeToString, nullopt for anything else.
+     */
+    static auto parseBlockType(const std::string &text) -> std::optional<BlockType> {
+        for (int ii = 0; ii < kBlockTypes; ++ii) {
+            if (text == blockTypeToString(static_cast<BlockType>(ii))) { return static_cast<BlockType>(ii); }
+        }
+        return std::nullopt;
+    }
+
+    auto readLegacyChunkFile(const std::filesystem::path &path) -> std::optional<Chunk> {
+        const auto mappedFile = util::MappedFile::open(path);
+        if (mappedFile == nullptr) {
+            spdlog::error("Failed to open legacy chunk {}", path.string());
+            return std::nullopt;
+        }
+
+        const std::string_view xml(reinterpret_cast<const char *>(mappedFile->bytes().data()), mappedFile->size());
+        auto stripped = stripLegacyChunkLists(xml);
+        if (!stripped.has_value()) {
+            spdlog::error("Legacy chunk {} is missing its index or vertex list", path.string());
+            return std::nullopt;
+        }
+
+        // What's left is a few dozen nodes, parsed in place with nothing but escapes turned on
+        pugi::xml_document chunkDocument;
+        const pugi::xml_parse_result parseResult = chunkDocument.load_buffer_inplace(
+                stripped->data(), stripped->size(), pugi::parse_minimal | pugi::parse_escapes);
+        if (!parseResult) {
+            spdlog::error("Failed to load legacy chunk {} with error: {}", path.string(), parseResult.description());
+            return std::nullopt;
+        }
+
+        // Components are written in a fixed order: id, name, shader module, isStatic, dimensions, transform,
+        // indices and vertices
+        const pugi::xml_node projectNode = chunkDocument.child("project");
+        const pugi::xml_node identifierComponent = projectNode.child("component");
+        const pugi::xml_node nameComponent = identifierComponent.next_sibling();
+        const pugi::xml_node shaderModuleComponent = nameComponent.next_sibling();
+        const pugi::xml_node isStaticComponent = shaderModuleComponent.next_sibling();
+        const pugi::xml_node dimensionsComponent = isStaticComponent.next_sibling();
+        const pugi::xml_node transformComponent = dimensionsComponent.next_sibling();
+        const pugi::xml_node indicesComponent = transformComponent.next_sibling();
+        const pugi::xml_node verticesComponent = indicesComponent.next_sibling();
+
+        const auto identifier = uuids::uuid::from_string(identifierComponent.attribute("value").value());
+        if (!identifier.has_value()) {
+            spdlog::error("Legacy chunk {} has no valid id", path.string());
+            return std::nullopt;
+        }
+
+        const auto dimensions = parseMap(dimensionsComponent, "dim");
+        const auto transform = parseMap(transformComponent, "transform");
+        if (!dimensions.has_value() || !transform.has_value()) {
+            spdlog::error("Legacy chunk {} has dimensions or a transform which are not numbers", path.string());
+            return std::nullopt;
+        }
+
+        // Same limits as a .vxc chunk, so the voxel count below can't wrap
+        const auto nVoxels = chunkVoxelCount(dimensions.value());
+        if (!nVoxels.has_value()) {
+            spdlog::error("Legacy chunk {} has dimensions {}x{}x{}, which are not between 1 and {} voxels",
+                          path.string(), dimensions->x, dimensions->y, dimensions->z, kMaxChunkVoxels);
+            return std::nullopt;
+        }
+
+        const pugi::xml_node nNodesProperty = verticesComponent.child("property");
+        const pugi::xml_node blockTypeProperty = nNodesProperty.next_sibling();
+        const auto nNodes = parseNumber<usize>(nNodesProperty.attribute("value"));
+        const auto blockType = parseBlockType(blockTypeProperty.attribute("value").value());
+        if (!nNodes.has_value() || !blockType.has_value()) {
+            spdlog::error("Legacy chunk {} has a malformed vertex count or unknown block type {}", path.string(),
+                          blockTypeProperty.attribute("value").value());
+            return std::nullopt;
+        }
+
+        if (nNodes.value() != nVoxels.value() * kCubeVertices.size()) {
+            spdlog::warn("Chunk {} has {} vertices, expected {} for its dimensions", path.string(), nNodes.value(),
+                         nVoxels.value() * kCubeVertices.size());
+        }
+
+        // Legacy chunks are solid, so every one of the same size and type shares its voxels
+        VoxelStorage voxels;
+        voxels.assign(nVoxels.value(), blockType.value());
+        return Chunk(std::strcmp(isStaticComponent.attribute("value").value(), "true") == 0, blockType.value(),
+                     nameComponent.attribute("value").value(), shaderModuleComponent.attribute("value").value(),
+                     identifier.value(), dimensions->x, dimensions->y, dimensions->z, transform->x, transform->y,
+                     transform->z, std::move(voxels), {});
+    }
+
+    /**
+     * Appends a component holding a map keyed by x, y and z followed by `suffix`.
+     */
+    static void appendMap(pugi::xml_node &projectNode, const char *name, const char *suffix, const ivec3 &values) {
+        pugi::xml_node component = projectNode.append_child("component");
+        component.append_attribute("name") = name;
+        pugi::xml_node map = component.append_child("map");
+        for (int axis = 0; axis < 3; ++axis) {
+            pugi::xml_node entry = map.append_child("entry");
+            entry.append_attribute("key") = (std::string(1, static_cast<char>('x' + axis)) + suffix).c_str();
+            entry.append_attribute("value") = values[axis];
+        }
+    }
+
+    auto encodeLegacyChunk(const Chunk &chunk, const std::string &projectName) -> std::string {
+        // The legacy layout stores the mesh in world space, the chunk itself is left unmeshed
+        const auto mesh = shareChunkMesh(chunk.voxels, chunk.dimensions());
+
+        pugi::xml_document chunkDocument;
+        pugi::xml_node projectNode = chunkDocument.append_child("project");
+        projectNode.append_attribute("name") = projectName.c_str();
+        projectNode.append_attribute("version") =
+                util::semverToString(level_editor::kProjectFileVersionMajor, level_editor::kProjectFileVersionMinor,
+                                     level_editor::kProjectFileVersionPatch)
+                        .c_str();
+
+        const std::array<std::pair<const char *, std::string>, 3> strings = {
+                std::pair{"id", uuids::to_string(chunk.id)}, std::pair{"name", chunk.name},
+                std::pair{"shaderModule", chunk.shaderModule}};
+        for (const auto &[name, value] : strings) {
+            pugi::xml_node component = projectNode.append_child("component");
+            component.append_attribute("name") = name;
+            component.append_attribute("value") = value.c_str();
+        }
+
+        pugi::xml_node isStaticComponent = projectNode.append_child("component");
+        isStaticComponent.append_attribute("name") = "isStatic";
+        isStaticComponent.append_attribute("value") = chunk.isStatic;
+
+        appendMap(projectNode, "dimensions", "dim", chunk.dimensions());
+        appendMap(projectNode, "transform", "transform", ivec3(chunk.xtransform, chunk.ytransform, chunk.ztransform));
+
+        pugi::xml_node indicesComponent = projectNode.append_child("component");
+        indicesComponent.append_attribute("name") = "indices";
+        pugi::xml_node indicesNNodesProperty = indicesComponent.append_child("property");
+        indicesNNodesProperty.append_attribute("name") = "nNodes";
+        indicesNNodesProperty.append_attribute("value") = mesh->indices.size();
+
+        pugi::xml_node indicesList = indicesComponent.append_child("indices-list");
+        for (const auto &index : mesh->indices) { indicesList.append_child("item").append_attribute("index") = index; }
+
+        pugi::xml_node verticesComponent = projectNode.append_child("component");
+        verticesComponent.append_attribute("name") = "vertices";
+        pugi::xml_node verticesNNodesProperty = verticesComponent.append_child("property");
+        verticesNNodesProperty.append_attribute("name") = "nNodes";
+        verticesNNodesProperty.append_attribute("value") = mesh->vertices.size();
+
+        pugi::xml_node blockTypeProperty = verticesComponent.append_child("property");
+        blockTypeProperty.append_attribute("name") = "blockType";
+        blockTypeProperty.append_attribute("value") = blockTypeToString(chunk.blockType).c_str();
+
+        pugi::xml_node vertexTypeProperty = verticesComponent.append_child("property");
+        vertexTypeProperty.append_attribute("name") = "vertexType";
+        vertexTypeProperty.append_attribute("value") = "VertexColor";
+
+        pugi::xml_node verticesList = verticesComponent.append_child("vertices-list");
+        for (usize ii = 0; ii < mesh->vertices.size(); ++ii) {
+            const vec3 position = mesh->vertices.at(ii).position + chunk.translation();
+            pugi::xml_node vertexNode = verticesList.append_child("item");
+            vertexNode.append_attribute("index") = ii;
+            vertexNode.append_attribute("xpos") = position.x;
+            vertexNode.append_attribute("ypos") = position.y;
+            vertexNode.append_attribute("zpos") = position.z;
+        }
+
+        std::ostringstream contents;
+        chunkDocument.save(contents);
+        return contents.str();
+    }
+}// namespace vx::gfx
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "chunk.h"
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace vx::gfx {
+    /**
+     * Cuts the index and vertex lists out of a legacy XML chunk, leaving a small document with only the components
+     * readLegacyChunkFile looks at. The lists are skipped over without being parsed.
+     * @return The cut down document, or nullopt if the lists can't be found
+     */
+    auto stripLegacyChunkLists(std::string_view xml) -> std::optional<std::string>;
+
+    /**
+     * Reads a chunk from the XML files written before .vxc files so old projects can be migrated. Legacy chunks are
+     * solid blocks of their block type, so the voxels follow from the dimensions and the stored mesh is never read,
+     * it is rebuilt from the voxels when the chunk is first drawn.
+     * @return The chunk, or nullopt if the file is missing or malformed
+     */
+    auto readLegacyChunkFile(const std::filesystem::path &path) -> std::optional<Chunk>;
+
+    /**
+     * Serializes a chunk in the legacy XML layout, mesh included, for tools which still read it.
+     * @param {std::string} projectName - Written into the document header like every other project file
+     */
+    auto encodeLegacyChunk(const Chunk &chunk, const std::string &projectName) -> std::string;
+}// namespace vx::gfx
@@ -0,0 +1,346 @@
+#include "region_file.h"
+#include "../util/bytes.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace vx::gfx {
+    using util::getLittleEndian;
+    using util::putLittleEndian;
+
+    static auto sectorsFor(u64 nBytes) -> u32 {
+        return static_cast<u32>((nBytes + kRegionSectorSize - 1) / kRegionSectorSize);
+    }
+
+    static auto floorDivide(int value, int divisor) -> int {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    auto regionCoordinates(const vec3 &translation) -> ivec2 {
+        return {floorDivide(static_cast<int>(std::floor(translation.x)), kRegionSpan),
+                floorDivide(static_cast<int>(std::floor(translation.z)), kRegionSpan)};
+    }
+
+    auto regionFileName(const ivec2 &region) -> std::string {
+        return "r." + std::to_string(region.x) + "." + std::to_string(region.y) + ".vxr";
+    }
+
+    auto RegionFile::open(const std::filesystem::path &path) -> std::optional<RegionFile> {
+        const bool exists = std::filesystem::exists(path) && std::filesystem::file_size(path) > 0;
+
+        RegionFile region;
+        region.path_ = path;
+        region.file_ = util::BatchFile::open(path, true);
+        if (!region.file_.has_value()) {
+            spdlog::error("Failed to open region file {}", path.string());
+            return std::nullopt;
+        }
+
+        if (!exists) {
+            region.slots_.resize(kRegionInitialSlots);
+            region.usedSectors_.assign(1 + region.tableSectors(), true);
+
+            std::vector<u8> table(static_cast<usize>(region.tableSectors()) * kRegionSectorSize);
+            if (!region.writeHeader() || !region.writeBytes(kRegionSectorSize, table)) { return std::nullopt; }
+            return region;
+        }
+
+        std::array<u8, 12> header{};
+        if (!region.readBytes(0, header) ||
+            !std::equal(kRegionFileMagic.begin(), kRegionFileMagic.end(), header.begin())) {
+            spdlog::error("{} is not a region file", path.string());
+            return std::nullopt;
+        }
+
+        const auto version = getLittleEndian<u16>(&header.at(4));
+        if (version != kRegionFileVersion) {
+            spdlog::error("Region file {} has unsupported version {}", path.string(), version);
+            return std::nullopt;
+        }
+
+        // The count sizes allocations, a corrupt one must not be trusted beyond what the file could hold
+        const u32 nSlots = getLittleEndian<u32>(&header.at(8));
+        if (static_cast<u64>(nSlots) * kRegionSlotSize > region.file_->size()) {
+            spdlog::error("Region file {} claims {} slots, more than it can hold", path.string(), nSlots);
+            return std::nullopt;
+        }
+
+        region.slots_.resize(nSlots);
+        region.usedSectors_.assign(1 + region.tableSectors(), true);
+
+        std::vector<u8> table(region.slots_.size() * kRegionSlotSize);
+        if (!region.readBytes(kRegionSectorSize, table)) {
+            spdlog::error("Region file {} has a truncated slot table", path.string());
+            return std::nullopt;
+        }
+
+        const u64 fileSectors = sectorsFor(region.file_->size());
+        for (u32 index = 0; index < region.slots_.size(); ++index) {
+            const u8 *entry = table.data() + static_cast<usize>(index) * kRegionSlotSize;
+
+            std::array<uuids::uuid::value_type, 16> identifier{};
+            std::copy(entry, entry + 16, identifier.begin());
+            Slot slot{uuids::uuid(identifier), getLittleEndian<u32>(entry + 16), getLittleEndian<u32>(entry + 20)};
+            if (slot.id.is_nil()) { continue; }
+
+            // A slot pointing into the table or past the end of the file can't be read, drop it
+            const u32 nSectors = sectorsFor(slot.byteLength);
+            const u64 endSector = static_cast<u64>(slot.firstSector) + nSectors;
+            if (slot.firstSector < 1 + region.tableSectors() || endSector > fileSectors) {
+                spdlog::error("Region file {} has a corrupt slot for chunk {}", path.string(),
+                              uuids::to_string(slot.id));
+                continue;
+            }
+
+            // Two slots claiming one chunk or one sector would have a write to either clobber the other
+            if (region.slotIndices_.contains(slot.id)) {
+                spdlog::error("Region file {} holds chunk {} twice", path.string(), uuids::to_string(slot.id));
+                return std::nullopt;
+            }
+
+            if (region.usedSectors_.size() < endSector) { region.usedSectors_.resize(endSector, false); }
+            const auto run = region.usedSectors_.begin() + slot.firstSector;
+            if (std::find(run, run + nSectors, true) != run + nSectors) {
+                spdlog::error("Region file {} has overlapping chunks at {}", path.string(), uuids::to_string(slot.id));
+                return std::nullopt;
+            }
+            std::fill_n(run, nSectors, true);
+
+            region.slots_.at(index) = slot;
+            region.slotIndices_[slot.id] = index;
+        }
+
+        return region;
+    }
+
+    auto RegionFile::chunkIds() const -> std::vector<uuids::uuid> {
+        std::vector<uuids::uuid> ids;
+        ids.reserve(slotIndices_.size());
+        for (const auto &slot : slots_) {
+            if (!slot.id.is_nil()) { ids.push_back(slot.id); }
+        }
+        return ids;
+    }
+
+    auto RegionFile::read(const uuids::uuid &id, usize maxBytes) -> std::optional<std::vector<u8>> {
+        const auto found = slotIndices_.find(id);
+        if (found == slotIndices_.end()) { return std::nullopt; }
+
+        const auto &slot = slots_.at(found->second);
+        std::vector<u8> bytes(std::min<usize>(slot.byteLength, maxBytes));
+        if (!readBytes(static_cast<u64>(slot.firstSector) * kRegionSectorSize, bytes)) {
+            spdlog::error("Failed to read chunk {} from region file {}", uuids::to_string(id), path_.string());
+            return std::nullopt;
+        }
+        return bytes;
+    }
+
+    auto RegionFile::readAll(usize maxBytes) -> std::optional<std::vector<std::vector<u8>>> {
+        std::vector<std::vector<u8>> chunks;
+        std::vector<util::FileRead> reads;
+        chunks.reserve(slotIndices_.size());
+        reads.reserve(slotIndices_.size());
+        for (const auto &slot : slots_) {
+            if (slot.id.is_nil()) { continue; }
+            auto &bytes = chunks.emplace_back(std::min<usize>(slot.byteLength, maxBytes));
+            reads.push_back({static_cast<u64>(slot.firstSector) * kRegionSectorSize, bytes});
+        }
+
+        if (!file_->read(reads)) {
+            spdlog::error("Failed to read the chunks of region file {}", path_.string());
+            return std::nullopt;
+        }
+        return chunks;
+    }
+
+    auto RegionFile::write(const uuids::uuid &id, std::span<const u8> bytes) -> bool {
+        const std::array<RegionWrite, 1> writes = {RegionWrite{id, bytes}};
+        return write(writes);
+    }
+
+    auto RegionFile::write(std::span<const RegionWrite> writes) -> bool {
+        // The table is grown up front, growing it later would move chunks whose new sectors are already chosen
+        const auto nNew = static_cast<usize>(
+                std::count_if(writes.begin(), writes.end(), [this](const auto &write) { return !contains(write.id); }));
+        while (slots_.size() - slotIndices_.size() < nNew) {
+            if (!growTable()) { return false; }
+        }
+
+        struct Placement {
+            u32 slotIndex;
+            Slot previous;
+            u32 firstSector;
+            u32 nSectors;
+            bool moves;
+        };
+
+        std::vector<Placement> placements;
+        std::vector<util::FileWrite> payloads;
+        placements.reserve(writes.size());
+        payloads.reserve(writes.size());
+
+        auto freeSlot = slots_.begin();
+        for (const auto &[id, bytes] : writes) {
+            u32 slotIndex = 0;
+            if (const auto found = slotIndices_.find(id); found != slotIndices_.end()) {
+                slotIndex = found->second;
+            } else {
+                freeSlot = std::find_if(freeSlot, slots_.end(), [](const Slot &slot) { return slot.id.is_nil(); });
+                slotIndex = static_cast<u32>(freeSlot - slots_.begin());
+                slotIndices_.emplace(id, slotIndex);
+                ++freeSlot;
+            }
+
+            // A chunk which outgrew its sectors is written elsewhere before they are freed, so a failed write leaves
+            // the old copy intact
+            const auto &previous = slots_.at(slotIndex);
+            const u32 nSectors = sectorsFor(bytes.size());
+            const u32 oldSectors = previous.id.is_nil() ? 0 : sectorsFor(previous.byteLength);
+            const bool moves = oldSectors < nSectors;
+            const u32 firstSector = moves ? allocate(nSectors) : previous.firstSector;
+
+            placements.push_back({slotIndex, previous, firstSector, nSectors, moves});
+            payloads.push_back({static_cast<u64>(firstSector) * kRegionSectorSize, bytes});
+
+            // Claimed, so the next new chunk takes another slot
+            slots_.at(slotIndex) = Slot{id, firstSector, static_cast<u32>(bytes.size())};
+        }
+
+        if (!file_->write(payloads)) {
+            spdlog::error("Failed to write {} chunks to region file {}", writes.size(), path_.string());
+            for (const auto &placement : placements) {
+                if (placement.moves) { release(placement.firstSector, placement.nSectors); }
+                if (placement.previous.id.is_nil()) { slotIndices_.erase(slots_.at(placement.slotIndex).id); }
+                slots_.at(placement.slotIndex) = placement.previous;
+            }
+            return false;
+        }
+
+        std::vector<std::array<u8, kRegionSlotSize>> entries;
+        std::vector<util::FileWrite> slotWrites;
+        entries.reserve(placements.size());
+        slotWrites.reserve(placements.size());
+        for (const auto &placement : placements) {
+            const auto &previous = placement.previous;
+            if (!previous.id.is_nil()) {
+                const u32 oldSectors = sectorsFor(previous.byteLength);
+                if (placement.moves) {
+                    release(previous.firstSector, oldSectors);
+                } else {
+                    release(previous.firstSector + placement.nSectors, oldSectors - placement.nSectors);
+                }
+            }
+
+            const auto &entry = entries.emplace_back(encodeSlot(placement.slotIndex));
+            slotWrites.push_back({kRegionSectorSize + static_cast<u64>(placement.slotIndex) * kRegionSlotSize, entry});
+        }
+        return file_->write(slotWrites);
+    }
+
+    auto RegionFile::erase(const uuids::uuid &id) -> bool {
+        const auto found = slotIndices_.find(id);
+        if (found == slotIndices_.end()) { return false; }
+
+        auto &slot = slots_.at(found->second);
+        release(slot.firstSector, sectorsFor(slot.byteLength));
+        slot = Slot{};
+
+        const bool written = writeSlot(found->second);
+        slotIndices_.erase(found);
+        return written;
+    }
+
+    auto RegionFile::tableSectors() const -> u32 { return sectorsFor(slots_.size() * kRegionSlotSize); }
+
+    auto RegionFile::allocate(u32 nSectors) -> u32 {
+        // First fit, falling back to the end of the file
+        u32 runStart = 0;
+        u32 runLength = 0;
+        for (u32 sector = 0; sector < usedSectors_.size() && runLength < nSectors; ++sector) {
+            if (usedSectors_.at(sector)) {
+                runLength = 0;
+                runStart = sector + 1;
+            } else {
+                ++runLength;
+            }
+        }
+
+        if (runLength < nSectors) { runStart = static_cast<u32>(usedSectors_.size()) - runLength; }
+        if (usedSectors_.size() < runStart + nSectors) { usedSectors_.resize(runStart + nSectors, false); }
+        std::fill_n(usedSectors_.begin() + runStart, nSectors, true);
+        return runStart;
+    }
+
+    void RegionFile::release(u32 firstSector, u32 nSectors) {
+        std::fill_n(usedSectors_.begin() + firstSector, nSectors, false);
+    }
+
+    auto RegionFile::readBytes(u64 offset, std::span<u8> bytes) -> bool {
+        const std::array<util::FileRead, 1> reads = {util::FileRead{offset, bytes}};
+        return file_->read(reads);
+    }
+
+    auto RegionFile::writeBytes(u64 offset, std::span<const u8> bytes) -> bool {
+        const std::array<util::FileWrite, 1> writes = {util::FileWrite{offset, bytes}};
+        return file_->write(writes);
+    }
+
+    auto RegionFile::writeHeader() -> bool {
+        std::array<u8, kRegionSectorSize> header{};
+        std::copy(kRegionFileMagic.begin(), kRegionFileMagic.end(), header.begin());
+        putLittleEndian<u16>(&header.at(4), kRegionFileVersion);
+        putLittleEndian<u32>(&header.at(8), slots_.size());
+        return writeBytes(0, header);
+    }
+
+    auto RegionFile::writeSlot(u32 index) -> bool {
+        return writeBytes(kRegionSectorSize + static_cast<u64>(index) * kRegionSlotSize, encodeSlot(index));
+    }
+
+    auto RegionFile::encodeSlot(u32 index) const -> std::array<u8, kRegionSlotSize> {
+        const auto &slot = slots_.at(index);
+        std::array<u8, kRegionSlotSize> entry{};
+
+        const auto identifier = slot.id.as_bytes();
+        for (usize ii = 0; ii < identifier.size(); ++ii) { entry.at(ii) = static_cast<u8>(identifier[ii]); }
+        putLittleEndian<u32>(&entry.at(16), slot.firstSector);
+        putLittleEndian<u32>(&entry.at(20), slot.byteLength);
+        return entry;
+    }
+
+    auto RegionFile::growTable() -> bool {
+        const u32 oldTableEnd = 1 + tableSectors();
+        // A table left empty by a corrupt header still has to grow
+        const usize nSlots = std::max<usize>(slots_.size() * 2, kRegionInitialSlots);
+        const u32 newTableEnd = 1 + sectorsFor(nSlots * kRegionSlotSize);
+
+        // Reserve the sectors of the larger table so the chunks moved out of them can't be put back
+        if (usedSectors_.size() < newTableEnd) { usedSectors_.resize(newTableEnd, false); }
+        std::fill(usedSectors_.begin() + oldTableEnd, usedSectors_.begin() + newTableEnd, true);
+
+        for (u32 index = 0; index < slots_.size(); ++index) {
+            auto &slot = slots_.at(index);
+            if (slot.id.is_nil() || slot.firstSector >= newTableEnd) { continue; }
+
+            const auto bytes = read(slot.id);
+            if (!bytes.has_value()) { return false; }
+
+            const u32 nSectors = sectorsFor(slot.byteLength);
+            const u32 firstSector = allocate(nSectors);
+            if (!writeBytes(static_cast<u64>(firstSector) * kRegionSectorSize, bytes.value())) { return false; }
+
+            // Only the part of the old run past the new table is free again
+            for (u32 sector = slot.firstSector; sector < slot.firstSector + nSectors; ++sector) {
+                if (sector >= newTableEnd) { usedSectors_.at(sector) = false; }
+            }
+
+            slot.firstSector = firstSector;
+            if (!writeSlot(index)) { return false; }
+        }
+
+        // The new slots are written before the header so the file is never read with a table larger than it holds
+        slots_.resize(nSlots);
+        std::vector<u8> newSlots((newTableEnd - oldTableEnd) * kRegionSectorSize);
+        if (!writeBytes(static_cast<u64>(oldTableEnd) * kRegionSectorSize, newSlots)) { return false; }
+        return writeHeader();
+    }
+}// namespace vx::gfx
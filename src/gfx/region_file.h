@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../math.h"
+#include "../util/batch_file.h"
+#include "../util/uuid.h"
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vx::gfx {
+    /*
+     * Region file (.vxr), packing the chunks of a kRegionSpan x kRegionSpan column of the world into one file.
+     * Every integer is little-endian and the file is divided into kRegionSectorSize byte sectors:
+     *   sector 0   magic "VXR\0", u16 version, u16 reserved, u32 slot count
+     *   sector 1   slot table, kRegionSlotSize bytes per slot: 16 byte chunk id, u32 first sector, u32 byte length
+     *              and 8 bytes reserved. A nil id marks a free slot.
+     *   after      chunk payloads (see encodeChunk), each in a run of contiguous sectors
+     */
+    static constexpr std::array<char, 4> kRegionFileMagic = {'V', 'X', 'R', '\0'};
+    static constexpr u16 kRegionFileVersion = 1;
+    static constexpr usize kRegionSectorSize = 4096;
+    static constexpr usize kRegionSlotSize = 32;
+
+    // A region covers a grid of kRegionChunks x kRegionChunks chunks kRegionChunkWidth voxels wide, and starts with
+    // a slot for each. Chunks are keyed by id rather than by grid cell since they can be any size, the table grows
+    // when a region holds more chunks than that.
+    static constexpr int kRegionChunks = 32;
+    static constexpr int kRegionChunkWidth = 16;
+    static constexpr int kRegionSpan = kRegionChunks * kRegionChunkWidth;
+    static constexpr u32 kRegionInitialSlots = kRegionChunks * kRegionChunks;
+
+    /**
+     * The region (along x and z) holding a chunk with the given translation.
+     */
+    auto regionCoordinates(const vec3 &translation) -> ivec2;
+    auto regionFileName(const ivec2 &region) -> std::string;
+
+    struct RegionWrite {
+        uuids::uuid id;
+        std::span<const u8> bytes;
+    };
+
+    /**
+     * A region file open for reading and in-place updates. Rewriting a chunk only touches its own sectors and its
+     * slot, a chunk which outgrows its sectors moves to the first free run large enough. Reading or writing many
+     * chunks at once goes to the file as a single batch (see util::BatchFile).
+     */
+    class RegionFile {
+    public:
+        static constexpr usize kReadWholeChunk = ~usize(0);
+
+        /**
+         * Opens a region file, creating an empty one if it doesn't exist.
+         * @return The region, or nullopt if it could not be created or is not a region file
+         */
+        static auto open(const std::filesystem::path &path) -> std::optional<RegionFile>;
+
+        auto chunkIds() const -> std::vector<uuids::uuid>;
+        auto contains(const uuids::uuid &id) const -> bool { return slotIndices_.contains(id); }
+        auto size() const -> usize { return slotIndices_.size(); }
+        auto byteLength(const uuids::uuid &id) const -> usize { return slots_.at(slotIndices_.at(id)).byteLength; }
+        auto sectors() const -> usize { return usedSectors_.size(); }
+
+        /**
+         * @param {usize} maxBytes - Reads no more than this many bytes from the front of the chunk
+         * @return The bytes stored for a chunk, or nullopt if the region doesn't hold it or the read failed
+         */
+        auto read(const uuids::uuid &id, usize maxBytes = kReadWholeChunk) -> std::optional<std::vector<u8>>;
+
+        /**
+         * Reads the bytes of every chunk in the region in one batch, in chunkIds() order.
+         * @param {usize} maxBytes - Reads no more than this many bytes from the front of each chunk
+         * @return The bytes of each chunk, or nullopt if the read failed
+         */
+        auto readAll(usize maxBytes = kReadWholeChunk) -> std::optional<std::vector<std::vector<u8>>>;
+
+        /**
+         * Stores a chunk's bytes, overwriting its sectors in place when they still fit.
+         */
+        auto write(const uuids::uuid &id, std::span<const u8> bytes) -> bool;
+
+        /**
+         * Stores the bytes of several chunks with distinct ids, the payloads and then their slots each go to the
+         * file in one batch.
+         * @return Whether every chunk was written, if not the chunks which moved keep their old copies
+         */
+        auto write(std::span<const RegionWrite> writes) -> bool;
+
+        /**
+         * Frees a chunk's slot and sectors, the file keeps its size and the sectors are reused by later writes.
+         */
+        auto erase(const uuids::uuid &id) -> bool;
+
+    private:
+        struct Slot {
+            uuids::uuid id;
+            u32 firstSector = 0;
+            u32 byteLength = 0;
+        };
+
+        std::filesystem::path path_;
+        std::optional<util::BatchFile> file_;
+
+        std::vector<Slot> slots_;
+        std::unordered_map<uuids::uuid, u32> slotIndices_;
+
+        // Whether each sector of the file is taken by the header, the table or a chunk
+        std::vector<bool> usedSectors_;
+
+        RegionFile() = default;
+
+        auto tableSectors() const -> u32;
+        auto allocate(u32 nSectors) -> u32;
+        void release(u32 firstSector, u32 nSectors);
+
+        auto readBytes(u64 offset, std::span<u8> bytes) -> bool;
+        auto writeBytes(u64 offset, std::span<const u8> bytes) -> bool;
+        auto writeHeader() -> bool;
+        auto writeSlot(u32 index) -> bool;
+        auto encodeSlot(u32 index) const -> std::array<u8, kRegionSlotSize>;
+
+        /**
+         * Doubles the slot table, moving any chunks in the way to the end of the file.
+         */
+        auto growTable() -> bool;
+    };
+}// namespace vx::gfx
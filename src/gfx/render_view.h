@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../math.h"
+
+namespace vx::gfx {
+    /**
+     * The camera state the chunk renderers need to cull and pick levels of detail.
+     */
+    struct RenderView {
+        // World-space position of the camera
+        vec3 eye = vec3(0);
+
+        // Pixels covered by one world unit at a distance of one unit from the eye
+        float projectionScale = 1.0f;
+    };
+}// namespace vx::gfx
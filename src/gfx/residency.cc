@@ -0,0 +1,43 @@
+#include "residency.h"
+#include <algorithm>
+
+namespace vx::gfx {
+    void ResidencyManager::touch(const ResidencyKey &key, u64 bytes) {
+        resize(key, bytes);
+        resident_.at(key).lastDrawnFrame = frame_;
+    }
+
+    void ResidencyManager::resize(const ResidencyKey &key, u64 bytes) {
+        auto &residency = resident_[key];
+        residentBytes_ = residentBytes_ - residency.bytes + bytes;
+        residency.bytes = bytes;
+    }
+
+    void ResidencyManager::erase(const ResidencyKey &key) {
+        const auto residency = resident_.find(key);
+        if (residency == resident_.end()) { return; }
+        residentBytes_ -= residency->second.bytes;
+        resident_.erase(residency);
+    }
+
+    auto ResidencyManager::evict() -> std::vector<ResidencyKey> {
+        if (residentBytes_ <= budgetBytes_) { return {}; }
+
+        std::vector<std::pair<u64, ResidencyKey>> candidates;
+        for (const auto &[key, residency] : resident_) {
+            if (residency.lastDrawnFrame < frame_ && residency.bytes > 0) {
+                candidates.emplace_back(residency.lastDrawnFrame, key);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+        std::vector<ResidencyKey> evicted;
+        for (const auto &[_frame, key] : candidates) {
+            if (residentBytes_ <= budgetBytes_) { break; }
+            erase(key);
+            evicted.push_back(key);
+        }
+        return evicted;
+    }
+}// namespace vx::gfx
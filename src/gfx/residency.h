@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../math.h"
+#include "../util/slot_map.h"
+#include <unordered_map>
+#include <vector>
+
+namespace vx::gfx {
+    static constexpr u64 kDefaultGpuBudgetBytes = 512ull * 1024 * 1024;
+
+    /**
+     * Something holding GPU buffers, a chunk by its handle or an HLOD cluster proxy by its cluster id.
+     */
+    struct ResidencyKey {
+        enum class Kind : u8 { kChunk, kCluster };
+
+        Kind kind = Kind::kChunk;
+        u32 id = 0;
+
+        static auto chunk(util::SlotHandle handle) -> ResidencyKey { return {Kind::kChunk, handle.value()}; }
+        static auto cluster(u32 clusterId) -> ResidencyKey { return {Kind::kCluster, clusterId}; }
+
+        auto chunkHandle() const -> util::SlotHandle {
+            return {id & util::SlotHandle::kIndexMask, id >> util::SlotHandle::kIndexBits};
+        }
+
+        auto operator==(const ResidencyKey &other) const -> bool = default;
+    };
+
+    struct ResidencyKeyHash {
+        auto operator()(const ResidencyKey &key) const -> usize {
+            return (static_cast<usize>(key.kind) << 32) | key.id;
+        }
+    };
+
+    /**
+     * Tracks the GPU bytes held by each chunk and cluster proxy and when it was last drawn, picking the least
+     * recently drawn to evict once the total goes over budget. Evicted chunks are uploaded again from their CPU
+     * data the next time they are drawn, evicted proxies are rebuilt.
+     */
+    class ResidencyManager {
+    public:
+        explicit ResidencyManager(u64 budgetBytes = kDefaultGpuBudgetBytes) : budgetBytes_(budgetBytes) {}
+
+        void nextFrame() { ++frame_; }
+
+        /**
+         * Records that a chunk or proxy was drawn this frame.
+         * @param {u64} bytes - GPU bytes it holds right now
+         */
+        void touch(const ResidencyKey &key, u64 bytes);
+
+        /**
+         * Updates the bytes of a chunk or proxy without counting it as drawn, used when its buffers change
+         * off-screen.
+         */
+        void resize(const ResidencyKey &key, u64 bytes);
+        void erase(const ResidencyKey &key);
+
+        /**
+         * Picks chunks and proxies to evict, least recently drawn first, until the rest fits the budget. Those
+         * drawn this frame are never picked, so the result may leave the total over budget. The picked ones are
+         * dropped from the manager.
+         */
+        auto evict() -> std::vector<ResidencyKey>;
+
+        void setBudget(u64 budgetBytes) { budgetBytes_ = budgetBytes; }
+        auto budget() const -> u64 { return budgetBytes_; }
+        auto residentBytes() const -> u64 { return residentBytes_; }
+
+    private:
+        struct Residency {
+            u64 bytes = 0;
+            u64 lastDrawnFrame = 0;
+        };
+
+        u64 frame_ = 0;
+        u64 budgetBytes_;
+        u64 residentBytes_ = 0;
+        std::unordered_map<ResidencyKey, Residency, ResidencyKeyHash> resident_;
+    };
+}// namespace vx::gfx
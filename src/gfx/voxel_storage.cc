@@ -0,0 +1,87 @@
+#include "voxel_storage.h"
+#include "../util/thread_pool.h"
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+
+namespace vx::gfx {
+    auto VoxelStorage::mapped(std::shared_ptr<const util::MappedFile> mappedFile, usize offset, usize count)
+            -> VoxelStorage {
+        static_assert(sizeof(BlockType) == 1);
+
+        VoxelStorage storage;
+        storage.mappedVoxels_ = {reinterpret_cast<const BlockType *>(mappedFile->bytes().data() + offset), count};
+        storage.mappedFile_ = std::move(mappedFile);
+        return storage;
+    }
+
+    auto VoxelStorage::deferred(usize count, VoxelLoader loader) -> VoxelStorage {
+        VoxelStorage storage;
+        storage.deferred_ = std::make_shared<DeferredVoxels>();
+        storage.deferred_->count = count;
+        storage.deferred_->loader = std::move(loader);
+        return storage;
+    }
+
+    void VoxelStorage::load() const {
+        if (deferred_ != nullptr) { load(*deferred_); }
+    }
+
+    void VoxelStorage::prefetch() const {
+        if (isLoaded() || deferred_->prefetched.exchange(true)) { return; }
+        util::ThreadPool::instance()->submit([deferred = deferred_]() { load(*deferred); });
+    }
+
+    void VoxelStorage::load(DeferredVoxels &deferred) {
+        std::call_once(deferred.once, [&deferred]() {
+            deferred.voxels = std::make_shared<std::vector<BlockType>>(deferred.loader());
+            if (deferred.voxels->size() != deferred.count) {
+                spdlog::error("Failed to load {} voxels, got {}", deferred.count, deferred.voxels->size());
+                deferred.voxels->assign(deferred.count, BlockType::kDefault);
+            }
+
+            // The loader holds on to whatever it reads from, let that go
+            deferred.loader = nullptr;
+            deferred.loaded = true;
+        });
+    }
+
+    auto VoxelStorage::mutableVoxels() -> std::span<BlockType> {
+        if (deferred_ != nullptr) {
+            load();
+            owned_ = deferred_->voxels;
+            deferred_ = nullptr;
+        }
+        if (isMapped()) {
+            owned_ = std::make_shared<std::vector<BlockType>>(mappedVoxels_.begin(), mappedVoxels_.end());
+            mappedVoxels_ = {};
+            mappedFile_ = nullptr;
+        }
+
+        if (owned_ == nullptr) {
+            owned_ = std::make_shared<std::vector<BlockType>>();
+        } else if (solidFill_ || owned_.use_count() > 1) {
+            owned_ = std::make_shared<std::vector<BlockType>>(*owned_);
+        }
+        solidFill_ = false;
+        return *owned_;
+    }
+
+    void VoxelStorage::assign(usize count, BlockType blockType) {
+        // Fills are looked up by count and type, the table only keeps the ones some storage still holds
+        static std::mutex mutex;
+        static std::unordered_map<u64, std::weak_ptr<std::vector<BlockType>>> solidFills;
+
+        deferred_ = nullptr;
+        mappedVoxels_ = {};
+        mappedFile_ = nullptr;
+        solidFill_ = true;
+
+        std::lock_guard lock(mutex);
+        auto &fill = solidFills[(static_cast<u64>(count) << 8) | blockType];
+        owned_ = fill.lock();
+        if (owned_ == nullptr) {
+            owned_ = std::make_shared<std::vector<BlockType>>(count, blockType);
+            fill = owned_;
+        }
+    }
+}// namespace vx::gfx
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../math.h"
+#include "../util/mapped_file.h"
+#include "block.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace vx::gfx {
+    // Reads the voxels of a chunk whose payload wasn't loaded with it, may be called from any thread
+    using VoxelLoader = std::function<std::vector<BlockType>()>;
+
+    /**
+     * The voxels of a chunk, either owned, viewing the pages of a mapped chunk file or not loaded yet. Views are
+     * read-only and copy the voxels into owned storage the first time they are written through (see
+     * mutableVoxels), so unedited chunks never copy their voxels out of the page cache. Copies of a view share the
+     * mapping. Deferred voxels are read the first time anything looks at them, copies share the one read.
+     *
+     * Owned voxels are copy-on-write, copies share them until one of the copies is written through. Copies are
+     * made on the main thread, so a storage which is the only holder of its voxels can write them in place.
+     */
+    class VoxelStorage {
+    public:
+        VoxelStorage() = default;
+        VoxelStorage(std::vector<BlockType> voxels)
+            : owned_(std::make_shared<std::vector<BlockType>>(std::move(voxels))) {}
+
+        /**
+         * Views `count` voxels starting `offset` bytes into a mapped file.
+         */
+        static auto mapped(std::shared_ptr<const util::MappedFile> mappedFile, usize offset, usize count)
+                -> VoxelStorage;
+
+        /**
+         * `count` voxels which `loader` reads when they are first needed.
+         */
+        static auto deferred(usize count, VoxelLoader loader) -> VoxelStorage;
+
+        auto size() const -> usize {
+            if (deferred_ != nullptr) { return deferred_->count; }
+            if (isMapped()) { return mappedVoxels_.size(); }
+            return owned_ == nullptr ? 0 : owned_->size();
+        }
+        auto empty() const -> bool { return size() == 0; }
+        auto isMapped() const -> bool { return mappedFile_ != nullptr; }
+        auto isLoaded() const -> bool { return deferred_ == nullptr || deferred_->loaded; }
+
+        /**
+         * Reads deferred voxels now, blocking until they are in memory.
+         */
+        void load() const;
+
+        /**
+         * Starts reading deferred voxels on the thread pool, so they are likely in memory by the time they are
+         * needed. Only the first call does anything.
+         */
+        void prefetch() const;
+
+        auto span() const -> std::span<const BlockType> {
+            if (deferred_ != nullptr) {
+                load();
+                return *deferred_->voxels;
+            }
+            if (isMapped()) { return mappedVoxels_; }
+            return owned_ == nullptr ? std::span<const BlockType>() : std::span<const BlockType>(*owned_);
+        }
+        auto data() const -> const BlockType * { return span().data(); }
+        auto at(usize index) const -> BlockType { return span()[index]; }
+        auto begin() const { return span().begin(); }
+        auto end() const { return span().end(); }
+
+        /**
+         * Whether both hold the same voxels in memory, rather than equal copies.
+         */
+        auto sharesWith(const VoxelStorage &other) const -> bool {
+            return !empty() && size() == other.size() && data() == other.data();
+        }
+
+        /**
+         * Writable voxels, copying them out of the mapping first if this is a view, or out of the storage it
+         * shares them with.
+         */
+        auto mutableVoxels() -> std::span<BlockType>;
+
+        /**
+         * Replaces the voxels with `count` voxels of a single type, dropping any mapping. Every storage filled
+         * with the same count and type shares one copy until it is written through.
+         */
+        void assign(usize count, BlockType blockType);
+        void clear() { assign(0, BlockType::kDefault); }
+
+        auto operator==(const VoxelStorage &other) const -> bool {
+            return sharesWith(other) || std::equal(begin(), end(), other.begin(), other.end());
+        }
+
+    private:
+        struct DeferredVoxels {
+            usize count = 0;
+            VoxelLoader loader;
+
+            std::once_flag once;
+            std::atomic<bool> prefetched = false;
+            std::atomic<bool> loaded = false;
+            std::shared_ptr<std::vector<BlockType>> voxels;
+        };
+
+        std::shared_ptr<std::vector<BlockType>> owned_;
+
+        // Set while owned_ is one of the shared solid fills handed out by assign, which are never written in place
+        bool solidFill_ = false;
+
+        std::shared_ptr<const util::MappedFile> mappedFile_;
+        std::span<const BlockType> mappedVoxels_;
+
+        std::shared_ptr<DeferredVoxels> deferred_;
+
+        static void load(DeferredVoxels &deferred);
+    };
+}// namespace vx::gfx
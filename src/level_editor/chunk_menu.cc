@@ -26,9 +26,10 @@ namespace vx::level_editor {
         const std::string addNewChunkPopupIdentifier = "Add New Chunk";
         const std::string editChunkPopupIdentifier = "Edit Chunk";
 
-        std::vector<uuids::uuid> deletedChunks;
+        std::vector<gfx::ChunkHandle> deletedChunks;
 
-        gfx::Chunk *editedChunk = nullptr;
+        // Stays valid while other chunks are added or deleted, and goes stale if the edited chunk is deleted
+        gfx::ChunkHandle editedChunk;
     };
 
     struct ChunkMenuData {
@@ -69,7 +70,8 @@ namespace vx::level_editor {
 
     static void editChunkPopup() {
         ImGui::SetNextWindowSize(kPopupWindowSize);
-        if (chunkMenuState.editedChunk) {
+        auto *editedChunk = level_editor::Project::instance()->getChunks().get(chunkMenuState.editedChunk);
+        if (editedChunk != nullptr) {
             if (ImGui::BeginPopupModal(chunkMenuState.editChunkPopupIdentifier.c_str())) {
                 ImGui::Text("Name");
                 ImGui::InputText("##name", chunkMenuData.chunkName, 512);
@@ -131,22 +133,15 @@ namespace vx::level_editor {
                     const vec3 chunkTranslation(chunkMenuData.xtransform, chunkMenuData.ytransform,
                                                 chunkMenuData.ztransform);
 
-                    if (std::strcmp(chunkMenuState.editedChunk->name.c_str(), chunkMenuData.chunkName) != 0) {
-                        // Rename file
-                        fs::rename(level_editor::Project::instance()->gameObjectFolderPath() /
-                                           (chunkMenuState.editedChunk->name + paths::kXmlPostfix),
-                                   level_editor::Project::instance()->gameObjectFolderPath() /
-                                           (std::string(chunkMenuData.chunkName) + paths::kXmlPostfix));
-
-                        // Assign name to object
-                        chunkMenuState.editedChunk->name = chunkMenuData.chunkName;
-                    }
-                    chunkMenuState.editedChunk->shaderModule = chunkMenuData.shaderModule;
-                    chunkMenuState.editedChunk->isStatic = chunkMenuData.isStatic;
-                    chunkMenuState.editedChunk->setGeometry(chunkDimensions, chunkTranslation, chunkMenuData.blockType);
+                    // Chunks are stored by id, so renaming only changes the object
+                    editedChunk->name = chunkMenuData.chunkName;
+                    editedChunk->shaderModule = chunkMenuData.shaderModule;
+                    editedChunk->isStatic = chunkMenuData.isStatic;
+                    editedChunk->setGeometry(chunkDimensions, chunkTranslation, chunkMenuData.blockType);
+                    editedChunk->write();
 
                     // Tell the render step to reload the objects in memory
-                    chunkMenuState.editedChunk->needsUpdate = true;
+                    editedChunk->needsUpdate = true;
                     ImGui::CloseCurrentPopup();
                 }
                 if (chunkSizeInvalid) { gui::popDisabled(); }
@@ -254,15 +249,14 @@ namespace vx::level_editor {
                         const std::string name =
                                 ii == 0 ? chunkMenuData.chunkName
                                         : std::string(chunkMenuData.chunkName) + "_" + std::to_string(ii);
-                        const gfx::Chunk chunk(chunkDimensions, chunkTranslation + (vec3(ii, ii, ii) * splitFactorVec),
-                                               chunkMenuData.shaderModule, name, chunkMenuData.isStatic,
-                                               chunkMenuData.blockType);
-                        level_editor::Project::instance()->addChunk(chunk);
+                        level_editor::Project::instance()->emplaceChunk(
+                                chunkDimensions, chunkTranslation + (vec3(ii, ii, ii) * splitFactorVec),
+                                chunkMenuData.shaderModule, name, chunkMenuData.isStatic, chunkMenuData.blockType);
                     }
                 } else {
-                    const gfx::Chunk chunk(chunkDimensions, chunkTranslation, chunkMenuData.shaderModule,
-                                           chunkMenuData.chunkName, chunkMenuData.isStatic, chunkMenuData.blockType);
-                    level_editor::Project::instance()->addChunk(chunk);
+                    level_editor::Project::instance()->emplaceChunk(chunkDimensions, chunkTranslation,
+                                                                    chunkMenuData.shaderModule, chunkMenuData.chunkName,
+                                                                    chunkMenuData.isStatic, chunkMenuData.blockType);
                 }
 
                 if (!chunkMenuState.addAnotherChunk) { ImGui::CloseCurrentPopup(); }
@@ -288,45 +282,53 @@ namespace vx::level_editor {
         if (level_editor::Project::instance()->storage()->chunks().empty()) {
             ImGui::Text("No Chunks Loaded.");
         } else {
-            for (auto &[id, chunk] : level_editor::Project::instance()->getChunks()) {
+            auto &chunks = level_editor::Project::instance()->getChunks();
+            for (usize ii = 0; ii < chunks.size(); ++ii) {
+                auto &chunk = chunks.values().at(ii);
+                const auto handle = chunks.handles().at(ii);
                 if (ImGui::TreeNodeEx(chunk.name.c_str())) {
+                    // A selected chunk is likely to be edited, start reading its voxels if they aren't loaded yet
+                    chunk.voxels.prefetch();
+
                     ImGui::Text("id: %s", uuids::to_string(chunk.id).c_str());
                     ImGui::Text("Dims: %i, %i, %i", chunk.xdim, chunk.ydim, chunk.zdim);
                     ImGui::Text("Transform: %i, %i, %i", chunk.xtransform, chunk.ytransform, chunk.ztransform);
 
                     if (ImGui::Button("Edit")) {
                         chunkMenuState.editChunkPopupOpen = true;
-                        chunkMenuState.editedChunk = &chunk;
+                        chunkMenuState.editedChunk = handle;
 
                         // Pre-fill the data
                         // Assign the name since it's a non std::string type
-                        std::strcpy(chunkMenuData.chunkName, chunkMenuState.editedChunk->name.c_str());
+                        std::strcpy(chunkMenuData.chunkName, chunk.name.c_str());
 
                         // Map the selected shader option for the module combo box
                         chunkMenuState.selectedShaderModuleOption =
-                                paths::indexOfShaderModule(chunkMenuState.editedChunk->shaderModule);
+                                paths::indexOfShaderModule(chunk.shaderModule);
 
                         // Map the selected block type option for the block type combo box
-                        chunkMenuState.selectedBlockTypeOption = chunkMenuState.editedChunk->blockType;
+                        chunkMenuState.selectedBlockTypeOption = chunk.blockType;
 
                         // Set menu dims for overridding later
-                        chunkMenuData.xdim = chunkMenuState.editedChunk->xdim;
-                        chunkMenuData.ydim = chunkMenuState.editedChunk->ydim;
-                        chunkMenuData.zdim = chunkMenuState.editedChunk->zdim;
+                        chunkMenuData.xdim = chunk.xdim;
+                        chunkMenuData.ydim = chunk.ydim;
+                        chunkMenuData.zdim = chunk.zdim;
 
                         // Set menu transforms for overridding later
-                        chunkMenuData.xtransform = chunkMenuState.editedChunk->xtransform;
-                        chunkMenuData.ytransform = chunkMenuState.editedChunk->ytransform;
-                        chunkMenuData.ztransform = chunkMenuState.editedChunk->ztransform;
+                        chunkMenuData.xtransform = chunk.xtransform;
+                        chunkMenuData.ytransform = chunk.ytransform;
+                        chunkMenuData.ztransform = chunk.ztransform;
                     }
                     ImGui::SameLine();
-                    if (ImGui::Button("Delete")) { chunkMenuState.deletedChunks.push_back(chunk.id); }
+                    if (ImGui::Button("Delete")) { chunkMenuState.deletedChunks.push_back(handle); }
                     ImGui::TreePop();
                 }
             }
 
             // Delete chunks
-            for (const auto &id : chunkMenuState.deletedChunks) { level_editor::Project::instance()->deleteChunk(id); }
+            for (const auto handle : chunkMenuState.deletedChunks) {
+                level_editor::Project::instance()->deleteChunk(handle);
+            }
             // Clear the deleted chunks
             chunkMenuState.deletedChunks.clear();
         }
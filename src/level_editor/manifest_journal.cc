@@ -0,0 +1,105 @@
+#include "manifest_journal.h"
+#include "../util/bytes.h"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <spdlog/spdlog.h>
+
+namespace vx::level_editor {
+    using util::getLittleEndian;
+    using util::putLittleEndian;
+
+    static auto checksum(std::span<const u8> bytes) -> u32 {
+        u32 hash = 2166136261u;
+        for (const u8 byte : bytes) { hash = (hash ^ byte) * 16777619u; }
+        return hash;
+    }
+
+    auto Manifest::fromProjectNode(const pugi::xml_node &projectNode) -> Manifest {
+        Manifest manifest;
+        manifest.chunkCodec = gfx::chunkCodecFromString(projectNode.attribute("chunkCodec").value());
+        manifest.sequence = std::strtoull(projectNode.attribute("journalSequence").value(), nullptr, 10);
+
+        const pugi::xml_node regionsComponent = projectNode.find_child_by_attribute("component", "name", "regions");
+        for (const auto &child : regionsComponent.child("regions-list").children()) {
+            manifest.regionFileNames.insert(child.attribute("path").value());
+        }
+        return manifest;
+    }
+
+    void Manifest::replay(const ManifestJournal &journal) {
+        for (const auto &record : journal.records) {
+            // Left over from before the project file was last written
+            if (record.sequence <= sequence) { continue; }
+
+            switch (record.type) {
+                case ManifestRecordType::kAddRegion:
+                    regionFileNames.insert(record.value);
+                    break;
+                case ManifestRecordType::kRemoveRegion:
+                    regionFileNames.erase(record.value);
+                    break;
+                case ManifestRecordType::kSetChunkCodec:
+                    chunkCodec = gfx::chunkCodecFromString(record.value);
+                    break;
+            }
+            sequence = record.sequence;
+        }
+    }
+
+    auto manifestJournalPath(const std::filesystem::path &projectFilePath) -> std::filesystem::path {
+        auto path = projectFilePath;
+        return path.replace_extension(".journal");
+    }
+
+    auto encodeManifestRecord(const ManifestRecord &record) -> std::vector<u8> {
+        std::vector<u8> bytes(kManifestRecordHeaderSize);
+        bytes.insert(bytes.end(), record.value.begin(), record.value.end());
+        putLittleEndian<u32>(bytes.data(), record.value.size());
+        putLittleEndian<u64>(bytes.data() + 8, record.sequence);
+        bytes.at(16) = static_cast<u8>(record.type);
+        putLittleEndian<u32>(bytes.data() + 4, checksum(std::span<const u8>(bytes).subspan(8)));
+        return bytes;
+    }
+
+    auto decodeManifestJournal(std::span<const u8> bytes) -> ManifestJournal {
+        ManifestJournal journal;
+        usize offset = 0;
+        while (offset < bytes.size()) {
+            const auto remaining = bytes.subspan(offset);
+            if (remaining.size() < kManifestRecordHeaderSize ||
+                remaining.size() - kManifestRecordHeaderSize < getLittleEndian<u32>(remaining.data())) {
+                journal.truncated = true;
+                break;
+            }
+
+            const usize recordSize = kManifestRecordHeaderSize + getLittleEndian<u32>(remaining.data());
+            const auto record = remaining.first(recordSize);
+            if (checksum(record.subspan(8)) != getLittleEndian<u32>(record.data() + 4) ||
+                record[16] >= kManifestRecordTypes) {
+                journal.truncated = true;
+                break;
+            }
+
+            const auto *value = reinterpret_cast<const char *>(record.data() + kManifestRecordHeaderSize);
+            journal.records.push_back({getLittleEndian<u64>(record.data() + 8),
+                                       static_cast<ManifestRecordType>(record[16]),
+                                       std::string(value, recordSize - kManifestRecordHeaderSize)});
+            offset += recordSize;
+        }
+        return journal;
+    }
+
+    auto readManifestJournal(const std::filesystem::path &path) -> ManifestJournal {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) { return {}; }
+
+        const std::vector<u8> bytes(std::istreambuf_iterator<char>(file), {});
+        auto journal = decodeManifestJournal(bytes);
+        if (journal.truncated) {
+            spdlog::warn("Manifest journal {} ends in a damaged record, replaying the {} before it", path.string(),
+                         journal.records.size());
+        }
+        return journal;
+    }
+}// namespace vx::level_editor
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../gfx/chunk_file.h"
+#include "../math.h"
+#include <filesystem>
+#include <pugixml.hpp>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace vx::level_editor {
+    /*
+     * Manifest journal (project.journal), the changes to the project file since it was last written. Records are
+     * appended one after another, every integer little-endian:
+     *   0  u32 value length
+     *   4  u32 FNV-1a checksum of the rest of the record
+     *   8  u64 sequence number, increasing by one per record across the life of the project
+     *  16  u8  ManifestRecordType
+     *  17  value
+     * The project file stores the sequence number of the last record it includes, so records at or before it are
+     * skipped when the journal is replayed. A record cut short by a crash fails its checksum and ends the replay.
+     */
+    static constexpr usize kManifestRecordHeaderSize = 17;
+
+    // Journal size past which the project file is rewritten and the journal emptied
+    static constexpr u64 kManifestJournalCompactBytes = 64 * 1024;
+
+    enum class ManifestRecordType : u8 {
+        // A region file now holds chunks of the project, the value is its file name
+        kAddRegion = 0,
+        // A region file no longer holds any chunks, the value is its file name
+        kRemoveRegion,
+        // The codec chunks are saved with, the value is its name (see gfx::chunkCodecToString)
+        kSetChunkCodec,
+    };
+    static constexpr u8 kManifestRecordTypes = 3;
+
+    struct ManifestRecord {
+        u64 sequence = 0;
+        ManifestRecordType type = ManifestRecordType::kAddRegion;
+        std::string value;
+
+        auto operator==(const ManifestRecord &other) const -> bool = default;
+    };
+
+    struct ManifestJournal {
+        std::vector<ManifestRecord> records;
+
+        // Whether the journal ends in a torn or corrupt record, which was dropped
+        bool truncated = false;
+    };
+
+    /**
+     * What the project file and its journal describe together.
+     */
+    struct Manifest {
+        gfx::ChunkCodec chunkCodec = gfx::kDefaultChunkCodec;
+        std::set<std::string> regionFileNames;
+
+        // Sequence number of the last record taken in
+        u64 sequence = 0;
+
+        /**
+         * Reads the manifest stored in a project file, projects from before chunk compression take the default
+         * codec.
+         */
+        static auto fromProjectNode(const pugi::xml_node &projectNode) -> Manifest;
+
+        /**
+         * Applies the journal's records after `sequence`, in order.
+         */
+        void replay(const ManifestJournal &journal);
+    };
+
+    auto manifestJournalPath(const std::filesystem::path &projectFilePath) -> std::filesystem::path;
+
+    auto encodeManifestRecord(const ManifestRecord &record) -> std::vector<u8>;
+
+    /**
+     * Parses records from the start of a journal up to the first one which is incomplete or fails its checksum.
+     */
+    auto decodeManifestJournal(std::span<const u8> bytes) -> ManifestJournal;
+
+    /**
+     * Reads and parses a journal file, a missing file is an empty journal.
+     */
+    auto readManifestJournal(const std::filesystem::path &path) -> ManifestJournal;
+}// namespace vx::level_editor
@@ -1,12 +1,15 @@
 #include "./project.h"
+#include "../gfx/chunk_file.h"
 #include "../paths.h"
 #include "../util/strings.h"
+#include "../util/thread_pool.h"
 #include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
 
-constexpr int kProjectFileVersionMajor = 0;
-constexpr int kProjectFileVersionMinor = 1;
-constexpr int kProjectFileVersionPatch = 0;
+// Chunks parsed per thread pool job when loading a project
+constexpr usize kChunkLoadBatchSize = 64;
 
 namespace vx::level_editor {
     auto Project::instance() -> Project * {
@@ -16,6 +19,7 @@ namespace vx::level_editor {
 
     Project::Project() {
         chunkStorage_ = std::make_unique<gfx::ChunkStorage>();
+        saveQueue_ = std::make_unique<SaveQueue>(gameObjectFolderPath(), projectFilePath());
 
         // Make project folder
         if (!fs::exists(projectFolderPath())) {
@@ -28,42 +32,82 @@ namespace vx::level_editor {
         } else {// Otherwise, load the existing project.
             load();
         }
+
+        saveQueue_->start();
     }
 
-    void Project::render() { chunkStorage_->render(); }
-    void Project::destroy() { chunkStorage_->destroy(); }
-    void Project::addChunk(const gfx::Chunk &chunk) {
-        chunkStorage_->addChunk(chunk);
-        write();
+    void Project::render(const gfx::RenderView &view) { chunkStorage_->render(view); }
+    void Project::destroy() {
+        chunkStorage_->destroy();
+
+        // Nothing queued is lost on exit
+        saveQueue_->stop();
     }
 
-    void Project::deleteChunk(const uuids::uuid &chunkIdentifier) {
-        // Delete file
-        const auto &chunk = getChunkByIdentifier(chunkIdentifier);
-        const fs::path filename = chunk.name + paths::kXmlPostfix;
+    auto Project::addChunk(gfx::Chunk &&chunk) -> gfx::ChunkHandle {
+        // Saving the new chunk records its region in the manifest
+        return chunkStorage_->addChunk(std::move(chunk));
+    }
 
-        fs::remove(gameObjectFolderPath() / filename);
+    void Project::deleteChunk(gfx::ChunkHandle handle) {
+        // Chunks are persisted by id
+        const auto chunkIdentifier = chunkStorage_->chunks().at(handle).id;
+        saveQueue_->deleteChunk(chunkIdentifier);
+        setChunkRegion(chunkIdentifier, {});
 
         // Delete memory
-        chunkStorage_->deleteChunk(chunkIdentifier);
-        write();
+        chunkStorage_->deleteChunk(handle);
     }
 
-    auto Project::getChunks() -> std::unordered_map<uuids::uuid, gfx::Chunk> & { return chunkStorage_->chunks(); }
-    auto Project::getChunkByIdentifier(const uuids::uuid &chunkIdentifier) -> gfx::Chunk & {
-        // First, check if the key exists
-        if (chunkStorage_->chunks().contains(chunkIdentifier)) { return chunkStorage_->chunks().at(chunkIdentifier); }
+    void Project::setChunkCodec(gfx::ChunkCodec codec) {
+        chunkCodec_ = codec;
+        appendManifestRecord(ManifestRecordType::kSetChunkCodec, gfx::chunkCodecToString(codec));
+    }
 
-        spdlog::error("Chunk not found {}", uuids::to_string(chunkIdentifier));
+    void Project::writeChunk(const gfx::Chunk &chunk) {
+        saveQueue_->saveChunk(chunk, chunkCodec_);
+        setChunkRegion(chunk.id, gfx::regionFileName(gfx::regionCoordinates(chunk.translation())));
+    }
 
-#ifndef NDEBUG
-        spdlog::error("Dumping chunks");
-        for (auto &[id, chunk] : chunkStorage_->chunks()) { spdlog::info("chunk {}", chunk.name); }
-#endif
+    void Project::setChunkRegion(const uuids::uuid &chunkIdentifier, const std::string &fileName) {
+        const auto stored = chunkRegions_.find(chunkIdentifier);
+        const auto storedFileName = stored == chunkRegions_.end() ? std::string() : stored->second;
+        if (storedFileName == fileName) { return; }
+
+        // The manifest only changes when a region gains its first chunk or loses its last
+        if (!storedFileName.empty() && --regionChunkCounts_.at(storedFileName) == 0) {
+            regionChunkCounts_.erase(storedFileName);
+            appendManifestRecord(ManifestRecordType::kRemoveRegion, storedFileName);
+        }
 
-        assert(false && "CHUNK NOT FOUND");
+        if (fileName.empty()) {
+            chunkRegions_.erase(chunkIdentifier);
+        } else {
+            chunkRegions_[chunkIdentifier] = fileName;
+            if (regionChunkCounts_[fileName]++ == 0) { appendManifestRecord(ManifestRecordType::kAddRegion, fileName); }
+        }
     }
 
+    void Project::appendManifestRecord(ManifestRecordType type, std::string value) {
+        ManifestRecord record{++manifestSequence_, type, std::move(value)};
+        journalBytes_ += kManifestRecordHeaderSize + record.value.size();
+        saveQueue_->appendManifestRecord(std::move(record));
+
+        // Folds the journal into a new project file, which the save queue writes in the background
+        if (journalBytes_ > kManifestJournalCompactBytes) { write(); }
+    }
+
+    auto Project::makeVoxelLoader(const std::string &fileName, const uuids::uuid &chunkIdentifier)
+            -> gfx::VoxelLoader {
+        return [saveQueue = saveQueue_.get(), fileName, chunkIdentifier]() -> std::vector<gfx::BlockType> {
+            const auto bytes = saveQueue->readChunk(fileName, chunkIdentifier);
+            if (!bytes.has_value()) { return {}; }
+            return gfx::decodeChunkVoxels(bytes.value(), fileName).value_or(std::vector<gfx::BlockType>());
+        };
+    }
+
+    auto Project::getChunks() -> gfx::ChunkMap & { return chunkStorage_->chunks(); }
+
     auto Project::projectVersionString() -> std::string {
         return util::semverToString(kProjectFileVersionMajor, kProjectFileVersionMinor, kProjectFileVersionPatch);
     }
@@ -82,28 +126,34 @@ namespace vx::level_editor {
     void Project::write() {
         pugi::xml_document projectDocument;
         pugi::xml_node projectNode = projectXMLHeader(projectDocument);
+        projectNode.append_attribute("chunkCodec") = gfx::chunkCodecToString(chunkCodec_).c_str();
+        projectNode.append_attribute("journalSequence") = std::to_string(manifestSequence_).c_str();
+
+        // Paths for the region files holding the game objects
+        std::set<std::string> regionFileNames;
+        for (const auto &[fileName, _count] : regionChunkCounts_) { regionFileNames.insert(fileName); }
 
-        // Paths for the game objects
-        pugi::xml_node gameObjectsComponent = projectNode.append_child("component");
-        gameObjectsComponent.append_attribute("name") = "gameObjects";
+        pugi::xml_node regionsComponent = projectNode.append_child("component");
+        regionsComponent.append_attribute("name") = "regions";
 
-        pugi::xml_node gameObjectsComponentNNodesProperty = gameObjectsComponent.append_child("property");
-        gameObjectsComponentNNodesProperty.append_attribute("name") = "nNodes";
-        gameObjectsComponentNNodesProperty.append_attribute("value") = chunkStorage_->chunks().size();
+        pugi::xml_node regionsComponentNNodesProperty = regionsComponent.append_child("property");
+        regionsComponentNNodesProperty.append_attribute("name") = "nNodes";
+        regionsComponentNNodesProperty.append_attribute("value") = regionFileNames.size();
 
-        pugi::xml_node gameObjectsList = gameObjectsComponent.append_child("game-objects-list");
-        for (const auto &[_id, gameObjectChunk] : chunkStorage_->chunks()) {
-            pugi::xml_node gameObjectNode = gameObjectsList.append_child("item");
-            gameObjectNode.append_attribute("name") = gameObjectChunk.name.c_str();
-            gameObjectNode.append_attribute("path") = std::string(gameObjectChunk.name + paths::kXmlPostfix).c_str();
+        pugi::xml_node regionsList = regionsComponent.append_child("regions-list");
+        for (const auto &fileName : regionFileNames) {
+            pugi::xml_node regionNode = regionsList.append_child("item");
+            regionNode.append_attribute("path") = fileName.c_str();
         }
 
 #ifndef NDEBUG
         projectDocument.print(std::cout);
 #endif
 
-        const auto projectPath = paths::kProjectsPath / fs::path(name + paths::kXmlPostfix);
-        projectDocument.save_file(projectFilePath().c_str());
+        std::ostringstream contents;
+        projectDocument.save(contents);
+        saveQueue_->saveProjectFile(contents.str(), manifestSequence_);
+        journalBytes_ = 0;
     }
 
     void Project::load() {
@@ -134,31 +184,133 @@ namespace vx::level_editor {
         const pugi::xml_node projectNode = projectDocument.child("project");
         name = projectNode.attribute("name").value();
 
-        // Now, load the fixtures
-        const pugi::xml_node gameObjectsComponent = projectNode.child("component");
-        const pugi::xml_node gameObjectsPropertyNode = gameObjectsComponent.child("property");
-        const pugi::xml_node gameObjectsList = gameObjectsPropertyNode.next_sibling();
+        // The project file holds the manifest as of its journal sequence number, the journal has what changed since
+        auto manifest = Manifest::fromProjectNode(projectNode);
+        const auto journal = readManifestJournal(manifestJournalPath(projectFilePath()));
+        manifest.replay(journal);
+        chunkCodec_ = manifest.chunkCodec;
+        manifestSequence_ = manifest.sequence;
+        const bool compactJournal = !journal.records.empty() || journal.truncated;
 
         bool needsRewrite = false;
-        for (const auto &child : gameObjectsList.children()) {
-            const auto chunk = gfx::Chunk::load(gameObjectFolderPath() / child.attribute("path").value());
-            spdlog::info("chunk {}", chunk->name);
-            // Fail gracefully when we encounter failures.
-            if (!chunk.has_value()) {
-                spdlog::error("Chunk {} failed to load", child.attribute("name").value());
-
-                // We can set this flag so that way when we exit this loop we know to reset the project file
-                // to prune the orphaned file handlers.
+
+        // Chunks are read and parsed on the thread pool and registered here a batch at a time, so opening a large
+        // project scales with the number of cores
+        auto *pool = util::ThreadPool::instance();
+
+        // Each region file is opened once and holds many chunks. Only their metadata is read up front, the voxels
+        // are read when a chunk is first drawn, selected or edited.
+        using RegionRecords = std::optional<std::vector<std::vector<u8>>>;
+        std::vector<std::pair<std::string, std::future<RegionRecords>>> regionReads;
+        for (const auto &fileName : manifest.regionFileNames) {
+            regionReads.emplace_back(fileName, pool->submit([this, fileName]() {
+                return saveQueue_->readRegion(fileName, true);
+            }));
+        }
+
+        std::vector<std::pair<std::string, std::future<std::vector<gfx::Chunk>>>> regionBatches;
+        for (auto &[fileName, regionRead] : regionReads) {
+            auto records = regionRead.get();
+            if (!records.has_value()) {
+                spdlog::error("Region {} failed to load", fileName);
                 needsRewrite = true;
-            } else {
-                chunkStorage_->addChunk(chunk.value(), false /* do not save */);
+                continue;
+            }
+
+            const auto sharedRecords = std::make_shared<const std::vector<std::vector<u8>>>(std::move(records.value()));
+            for (usize begin = 0; begin < sharedRecords->size(); begin += kChunkLoadBatchSize) {
+                const usize end = std::min(begin + kChunkLoadBatchSize, sharedRecords->size());
+                regionBatches.emplace_back(fileName, pool->submit([this, sharedRecords, begin, end, fileName]() {
+                    std::vector<gfx::Chunk> chunks;
+                    chunks.reserve(end - begin);
+                    for (usize ii = begin; ii < end; ++ii) {
+                        auto chunk = gfx::decodeChunkMetadata(sharedRecords->at(ii), fileName);
+                        if (!chunk.has_value()) { continue; }
+
+                        const usize nVoxels = static_cast<usize>(chunk->xdim) * chunk->ydim * chunk->zdim;
+                        chunk->voxels = gfx::VoxelStorage::deferred(nVoxels, makeVoxelLoader(fileName, chunk->id));
+                        chunks.push_back(std::move(chunk.value()));
+                    }
+                    return chunks;
+                }));
             }
         }
 
+        for (auto &[fileName, regionBatch] : regionBatches) {
+            auto chunks = regionBatch.get();
+            for (const auto &chunk : chunks) { chunkRegions_[chunk.id] = fileName; }
+            regionChunkCounts_[fileName] += chunks.size();
+            chunkStorage_->addChunks(std::move(chunks));
+        }
+
+        // Every region has been read, so the blobs none of their chunks refer to can go. A damaged project keeps
+        // them in case the regions which failed still need them.
+        if (!needsRewrite) { saveQueue_->collectBlobs(); }
+
+        // Projects from before region files list a file per chunk, these are moved into regions
+        std::vector<fs::path> legacyChunkPaths;
+        const pugi::xml_node gameObjectsComponent =
+                projectNode.find_child_by_attribute("component", "name", "gameObjects");
+        const pugi::xml_node gameObjectsPropertyNode = gameObjectsComponent.child("property");
+        const pugi::xml_node gameObjectsList = gameObjectsPropertyNode.next_sibling();
+        for (const auto &child : gameObjectsList.children()) {
+            legacyChunkPaths.push_back(gameObjectFolderPath() / child.attribute("path").value());
+        }
+
+        // Rewriting the project file drops the list whether or not its chunks load
+        if (!legacyChunkPaths.empty()) { needsRewrite = true; }
+
+        std::vector<std::future<std::vector<std::optional<gfx::Chunk>>>> legacyBatches;
+        for (usize begin = 0; begin < legacyChunkPaths.size(); begin += kChunkLoadBatchSize) {
+            const usize end = std::min(begin + kChunkLoadBatchSize, legacyChunkPaths.size());
+            legacyBatches.push_back(pool->submit(
+                    [chunkPaths = std::vector<fs::path>(legacyChunkPaths.begin() + begin,
+                                                        legacyChunkPaths.begin() + end)]() {
+                        std::vector<std::optional<gfx::Chunk>> chunks;
+                        chunks.reserve(chunkPaths.size());
+                        for (const auto &chunkPath : chunkPaths) { chunks.push_back(gfx::Chunk::load(chunkPath)); }
+                        return chunks;
+                    }));
+        }
+
+        std::vector<fs::path> migratedChunkPaths;
+        for (usize batch = 0; batch < legacyBatches.size(); ++batch) {
+            auto chunks = legacyBatches.at(batch).get();
+
+            std::vector<gfx::Chunk> loaded;
+            for (usize ii = 0; ii < chunks.size(); ++ii) {
+                const auto &chunkPath = legacyChunkPaths.at(batch * kChunkLoadBatchSize + ii);
+                // Fail gracefully when we encounter failures.
+                if (!chunks.at(ii).has_value()) {
+                    spdlog::error("Chunk {} failed to load", chunkPath.string());
+                    continue;
+                }
+
+                auto &chunk = chunks.at(ii).value();
+                spdlog::info("Migrating chunk {} to region files", chunk.name);
+                writeChunk(chunk);
+                migratedChunkPaths.push_back(chunkPath);
+                loaded.push_back(std::move(chunk));
+            }
+            chunkStorage_->addChunks(std::move(loaded));
+        }
+
         if (needsRewrite) {
-            spdlog::warn("Detected damaged project, attempting to repair");
+            spdlog::warn("Detected damaged or legacy project, attempting to repair");
             write();
+
+            // The old chunk files go once the regions and the project file pointing at them are written
+            saveQueue_->flush();
+            for (const auto &chunkPath : migratedChunkPaths) { fs::remove(chunkPath); }
             spdlog::info("Repair completed successfully");
+        } else if (compactJournal) {
+            // Replaying the journal again on every open would only get slower
+            write();
         }
     }
 }// namespace vx::level_editor
+
+namespace vx::gfx {
+    // Defined with the project rather than the chunk, so the chunk file formats don't depend on the editor
+    void Chunk::write() const noexcept { level_editor::Project::instance()->writeChunk(*this); }
+}// namespace vx::gfx
@@ -1,13 +1,19 @@
 #pragma once
 
 #include "../gfx/chunk.h"
+#include "../gfx/chunk_file.h"
 #include "../gfx/chunk_storage.h"
+#include "../gfx/region_file.h"
+#include "manifest_journal.h"
+#include "project_version.h"
+#include "save_queue.h"
 #include <filesystem>
 #include <memory>
 #include <optional>
 #include <pugixml.hpp>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -22,16 +28,40 @@ namespace vx::level_editor {
 
         static auto instance() -> Project *;
 
-        void render();
+        void render(const gfx::RenderView &view);
         void destroy();
-        void addChunk(const gfx::Chunk &chunk);
-        void deleteChunk(const uuids::uuid &chunkIdentifier);
+        /**
+         * Takes ownership of a new chunk and saves it.
+         * @return The handle the chunk is referred to by while it is in memory
+         */
+        auto addChunk(gfx::Chunk &&chunk) -> gfx::ChunkHandle;
+
+        /**
+         * Builds a new chunk from gfx::Chunk constructor arguments and adds it, without copying it on the way.
+         */
+        template<typename... Args>
+        auto emplaceChunk(Args &&...args) -> gfx::ChunkHandle {
+            return addChunk(gfx::Chunk(std::forward<Args>(args)...));
+        }
+        void deleteChunk(gfx::ChunkHandle handle);
+
+        /**
+         * Sets the codec chunks of this project are saved with. Chunks are rewritten with it as they are next saved,
+         * older files keep loading whatever codec they were written with.
+         */
+        void setChunkCodec(gfx::ChunkCodec codec);
+
+        /**
+         * Queues a save of a chunk into the region file covering its translation, taking it out of the region it
+         * was in if it moved to another. The save happens in the background (see SaveQueue).
+         */
+        void writeChunk(const gfx::Chunk &chunk);
 
         // ====== Getters
         //
         auto storage() -> std::unique_ptr<gfx::ChunkStorage> & { return chunkStorage_; }
-        auto getChunks() -> std::unordered_map<uuids::uuid, gfx::Chunk> &;
-        auto getChunkByIdentifier(const uuids::uuid &chunkIdentifier) -> gfx::Chunk &;
+        auto getChunks() -> gfx::ChunkMap &;
+        auto chunkCodec() const -> gfx::ChunkCodec { return chunkCodec_; }
 
         // Project file management
         auto projectVersionString() -> std::string;
@@ -48,10 +78,39 @@ namespace vx::level_editor {
         // Unique ref to chunk storage
         std::unique_ptr<gfx::ChunkStorage> chunkStorage_;
 
+        gfx::ChunkCodec chunkCodec_ = gfx::kDefaultChunkCodec;
+
+        // Writes chunks and the project file in the background
+        std::unique_ptr<SaveQueue> saveQueue_;
+
+        // The region file holding each chunk, and the number of chunks in each region the manifest lists
+        std::unordered_map<uuids::uuid, std::string> chunkRegions_;
+        std::unordered_map<std::string, usize> regionChunkCounts_;
+
+        // Sequence number of the last manifest record, and the bytes journaled since the project file was written
+        u64 manifestSequence_ = 0;
+        u64 journalBytes_ = 0;
+
         /**
-         * Write to the project configuration.
+         * Queue a write of the project configuration, which takes in every manifest record so far.
          */
         void write();
         void load();
+
+        /**
+         * Moves a chunk to another region in the manifest, or out of it if `fileName` is empty.
+         */
+        void setChunkRegion(const uuids::uuid &chunkIdentifier, const std::string &fileName);
+
+        /**
+         * Journals a change to the manifest, compacting the journal into the project file once it grows past
+         * kManifestJournalCompactBytes.
+         */
+        void appendManifestRecord(ManifestRecordType type, std::string value);
+
+        /**
+         * Reads the voxels of a chunk loaded without them from the region file it is stored in.
+         */
+        auto makeVoxelLoader(const std::string &fileName, const uuids::uuid &chunkIdentifier) -> gfx::VoxelLoader;
     };
 }// namespace vx::level_editor
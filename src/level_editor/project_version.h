@@ -0,0 +1,8 @@
+#pragma once
+
+namespace vx::level_editor {
+    // Version written to project files and legacy chunk files
+    static constexpr int kProjectFileVersionMajor = 0;
+    static constexpr int kProjectFileVersionMinor = 1;
+    static constexpr int kProjectFileVersionPatch = 0;
+}// namespace vx::level_editor
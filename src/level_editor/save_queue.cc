@@ -0,0 +1,295 @@
+#include "save_queue.h"
+#include <chrono>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+namespace vx::level_editor {
+    SaveQueue::SaveQueue(std::filesystem::path gameObjectFolderPath, std::filesystem::path projectFilePath)
+        : gameObjectFolderPath_(std::move(gameObjectFolderPath)), projectFilePath_(std::move(projectFilePath)) {}
+
+    SaveQueue::~SaveQueue() { stop(); }
+
+    void SaveQueue::start() {
+        if (worker_.joinable()) { return; }
+        {
+            std::lock_guard lock(queueMutex_);
+            stopping_ = false;
+        }
+        worker_ = std::thread([this]() { work(); });
+    }
+
+    void SaveQueue::stop() {
+        {
+            std::lock_guard lock(queueMutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        if (worker_.joinable()) { worker_.join(); }
+
+        // Anything queued after the worker's last flush
+        flush();
+    }
+
+    void SaveQueue::flush() {
+        std::lock_guard ioLock(ioMutex_);
+
+        std::unordered_map<uuids::uuid, PendingChunk> chunks;
+        std::optional<PendingProjectFile> projectFile;
+        std::vector<ManifestRecord> records;
+        {
+            std::lock_guard lock(queueMutex_);
+            chunks.swap(pendingChunks_);
+            projectFile.swap(pendingProjectFile_);
+            records.swap(pendingRecords_);
+        }
+
+        // Saves are grouped by the region they go to, so each region is written in one batch
+        std::unordered_map<std::string, std::vector<std::pair<uuids::uuid, gfx::ChunkBlob>>> saves;
+        for (const auto &[chunkIdentifier, pending] : chunks) {
+            if (pending.chunk.has_value()) {
+                const auto &chunk = pending.chunk.value();
+                auto blob = gfx::encodeChunkBlob(chunk, pending.codec);
+                if (!blob.has_value()) {
+                    spdlog::error("Failed to encode chunk {}, it was not saved", uuids::to_string(chunkIdentifier));
+                    continue;
+                }
+                auto &encodedChunks = saves[gfx::regionFileName(gfx::regionCoordinates(chunk.translation()))];
+                encodedChunks.emplace_back(chunkIdentifier, std::move(blob.value()));
+            } else {
+                eraseStoredChunk(chunkIdentifier, {});
+            }
+        }
+
+        // The blobs go first so a chunk is never stored before its voxels, blobs already stored are skipped
+        std::vector<gfx::BlobWrite> blobWrites;
+        for (const auto &[_fileName, encodedChunks] : saves) {
+            for (const auto &[_chunkIdentifier, blob] : encodedChunks) {
+                blobWrites.push_back({blob.hash, blob.voxels});
+            }
+        }
+
+        if (!blobWrites.empty()) {
+            auto *blobs = blobStore();
+            if (blobs == nullptr || !blobs->write(blobWrites)) {
+                spdlog::error("Failed to save the voxels of {} chunks", blobWrites.size());
+                saves.clear();
+            }
+        }
+
+        for (const auto &[fileName, encodedChunks] : saves) { persistChunks(fileName, encodedChunks); }
+
+        // The manifest goes last so it never lists a region before its chunks are written. A new project file
+        // takes in every record up to its sequence number, the journal starts over with the ones after it.
+        if (projectFile.has_value() && writeProjectFile(projectFile->contents)) {
+            std::erase_if(records, [&](const auto &record) { return record.sequence <= projectFile->journalSequence; });
+            writeJournal(records, true);
+        } else if (!records.empty()) {
+            writeJournal(records, false);
+        }
+    }
+
+    void SaveQueue::saveChunk(const gfx::Chunk &chunk, gfx::ChunkCodec codec) {
+        // Deferred voxels read through readChunk, which can't run during the flush that encodes the snapshot
+        chunk.voxels.load();
+
+        // Only the persisted state is copied, the mesh is rebuilt from the voxels on load
+        gfx::Chunk snapshot(chunk.isStatic, chunk.blockType, chunk.name, chunk.shaderModule, chunk.id, chunk.xdim,
+                            chunk.ydim, chunk.zdim, chunk.xtransform, chunk.ytransform, chunk.ztransform,
+                            chunk.voxels, {});
+
+        std::lock_guard lock(queueMutex_);
+        pendingChunks_.insert_or_assign(chunk.id, PendingChunk{std::move(snapshot), codec});
+    }
+
+    void SaveQueue::deleteChunk(const uuids::uuid &chunkIdentifier) {
+        std::lock_guard lock(queueMutex_);
+        pendingChunks_.insert_or_assign(chunkIdentifier, PendingChunk{});
+    }
+
+    void SaveQueue::saveProjectFile(std::string contents, u64 journalSequence) {
+        std::lock_guard lock(queueMutex_);
+        pendingProjectFile_ = PendingProjectFile{std::move(contents), journalSequence};
+    }
+
+    void SaveQueue::appendManifestRecord(ManifestRecord record) {
+        std::lock_guard lock(queueMutex_);
+        pendingRecords_.push_back(std::move(record));
+    }
+
+    auto SaveQueue::readRegion(const std::string &fileName, bool metadataOnly)
+            -> std::optional<std::vector<std::vector<u8>>> {
+        if (!std::filesystem::exists(gameObjectFolderPath_ / fileName)) { return std::nullopt; }
+
+        // The region isn't known to the queue yet, so it is read without holding the lock
+        auto regionFile = gfx::RegionFile::open(gameObjectFolderPath_ / fileName);
+        if (!regionFile.has_value()) { return std::nullopt; }
+
+        const auto chunkIdentifiers = regionFile->chunkIds();
+        const usize maxChunkBytes = metadataOnly ? gfx::kChunkMetadataPrefixSize : gfx::RegionFile::kReadWholeChunk;
+        auto chunks = regionFile->readAll(maxChunkBytes);
+        if (!chunks.has_value()) { return std::nullopt; }
+
+        // Chunks with unusually long names need more than the prefix
+        for (usize ii = 0; metadataOnly && ii < chunkIdentifiers.size(); ++ii) {
+            auto &bytes = chunks->at(ii);
+            const usize metadataSize = gfx::chunkMetadataSize(bytes);
+            if (bytes.size() >= metadataSize || bytes.size() == regionFile->byteLength(chunkIdentifiers.at(ii))) {
+                continue;
+            }
+
+            auto metadata = regionFile->read(chunkIdentifiers.at(ii), metadataSize);
+            if (metadata.has_value()) { bytes = std::move(metadata.value()); }
+        }
+
+        std::lock_guard ioLock(ioMutex_);
+        for (usize ii = 0; ii < chunkIdentifiers.size(); ++ii) {
+            const auto &chunkIdentifier = chunkIdentifiers.at(ii);
+            storedRegions_[chunkIdentifier] = fileName;
+
+            const auto hash = gfx::chunkBlobHash(chunks->at(ii));
+            if (hash.has_value()) { storedBlobs_[chunkIdentifier] = hash.value(); }
+
+            // A chunk whose blob is missing keeps its record, decoding it reports the damage
+            if (!metadataOnly) {
+                auto attached = attachBlob(chunks->at(ii), fileName);
+                if (attached.has_value()) { chunks->at(ii) = std::move(attached.value()); }
+            }
+        }
+        regions_.emplace(fileName, std::move(regionFile.value()));
+        return chunks;
+    }
+
+    auto SaveQueue::readChunk(const std::string &fileName, const uuids::uuid &chunkIdentifier)
+            -> std::optional<std::vector<u8>> {
+        std::lock_guard ioLock(ioMutex_);
+        const auto found = regions_.find(fileName);
+        if (found == regions_.end()) { return std::nullopt; }
+
+        auto record = found->second.read(chunkIdentifier);
+        if (!record.has_value()) { return std::nullopt; }
+        return attachBlob(std::move(record.value()), fileName);
+    }
+
+    auto SaveQueue::collectBlobs() -> usize {
+        std::lock_guard ioLock(ioMutex_);
+        auto *blobs = blobStore(false);
+        if (blobs == nullptr) { return 0; }
+
+        std::unordered_set<util::Hash128> referenced;
+        for (const auto &[_chunkIdentifier, hash] : storedBlobs_) { referenced.insert(hash); }
+        return blobs->collect(referenced);
+    }
+
+    auto SaveQueue::pending() -> usize {
+        std::lock_guard lock(queueMutex_);
+        return pendingChunks_.size() + (pendingProjectFile_.has_value() ? 1 : 0) + pendingRecords_.size();
+    }
+
+    void SaveQueue::work() {
+        const auto interval = std::chrono::duration<double>(kSaveFlushIntervalSeconds);
+        std::unique_lock lock(queueMutex_);
+        while (!stopping_) {
+            wake_.wait_for(lock, interval, [this]() { return stopping_; });
+
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    auto SaveQueue::region(const std::string &fileName) -> gfx::RegionFile * {
+        if (!regions_.contains(fileName)) {
+            auto regionFile = gfx::RegionFile::open(gameObjectFolderPath_ / fileName);
+            if (!regionFile.has_value()) { return nullptr; }
+            regions_.emplace(fileName, std::move(regionFile.value()));
+        }
+        return &regions_.at(fileName);
+    }
+
+    auto SaveQueue::blobStore(bool create) -> gfx::BlobStore * {
+        const auto path = gameObjectFolderPath_ / gfx::kBlobStoreFileName;
+        if (!blobStore_.has_value()) {
+            if (!create && !std::filesystem::exists(path)) { return nullptr; }
+            blobStore_ = gfx::BlobStore::open(path);
+        }
+        return blobStore_.has_value() ? &blobStore_.value() : nullptr;
+    }
+
+    auto SaveQueue::attachBlob(std::vector<u8> record, const std::string &source) -> std::optional<std::vector<u8>> {
+        const auto hash = gfx::chunkBlobHash(record);
+        if (!hash.has_value()) { return record; }
+
+        auto *blobs = blobStore(false);
+        auto voxels = blobs == nullptr ? std::nullopt : blobs->read(hash.value());
+        if (!voxels.has_value()) {
+            spdlog::error("Blob {} of a chunk in {} is missing", hash->toString(), source);
+            return std::nullopt;
+        }
+        return gfx::attachChunkBlob(record, voxels.value());
+    }
+
+    void SaveQueue::persistChunks(const std::string &fileName,
+                                  const std::vector<std::pair<uuids::uuid, gfx::ChunkBlob>> &encodedChunks) {
+        std::vector<gfx::RegionWrite> writes;
+        writes.reserve(encodedChunks.size());
+        for (const auto &[chunkIdentifier, blob] : encodedChunks) { writes.push_back({chunkIdentifier, blob.record}); }
+
+        auto *regionFile = region(fileName);
+        if (regionFile == nullptr || !regionFile->write(writes)) {
+            spdlog::error("Failed to save {} chunks to region {}", encodedChunks.size(), fileName);
+            return;
+        }
+
+        for (const auto &[chunkIdentifier, blob] : encodedChunks) {
+            eraseStoredChunk(chunkIdentifier, fileName);
+            storedRegions_[chunkIdentifier] = fileName;
+            storedBlobs_[chunkIdentifier] = blob.hash;
+        }
+    }
+
+    void SaveQueue::eraseStoredChunk(const uuids::uuid &chunkIdentifier, const std::string &keptFileName) {
+        const auto stored = storedRegions_.find(chunkIdentifier);
+        if (stored == storedRegions_.end() || stored->second == keptFileName) { return; }
+
+        // Deleted, or moved into another region
+        const auto storedFileName = stored->second;
+        storedRegions_.erase(stored);
+        storedBlobs_.erase(chunkIdentifier);
+
+        auto *regionFile = region(storedFileName);
+        if (regionFile == nullptr) { return; }
+        regionFile->erase(chunkIdentifier);
+        if (regionFile->size() == 0) {
+            regions_.erase(storedFileName);
+            std::filesystem::remove(gameObjectFolderPath_ / storedFileName);
+        }
+    }
+
+    auto SaveQueue::writeProjectFile(const std::string &contents) -> bool {
+        auto temporaryPath = projectFilePath_;
+        temporaryPath += ".tmp";
+
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        file.close();
+
+        std::error_code error;
+        if (!file || (std::filesystem::rename(temporaryPath, projectFilePath_, error), error)) {
+            spdlog::error("Failed to write project file {}", projectFilePath_.string());
+            return false;
+        }
+        return true;
+    }
+
+    void SaveQueue::writeJournal(const std::vector<ManifestRecord> &records, bool truncate) {
+        const auto journalPath = manifestJournalPath(projectFilePath_);
+        std::ofstream file(journalPath, std::ios::binary | (truncate ? std::ios::trunc : std::ios::app));
+        for (const auto &record : records) {
+            const auto bytes = encodeManifestRecord(record);
+            file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        file.close();
+        if (!file) { spdlog::error("Failed to write manifest journal {}", journalPath.string()); }
+    }
+}// namespace vx::level_editor
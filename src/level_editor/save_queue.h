@@ -0,0 +1,155 @@
+#pragma once
+
+#include "../gfx/blob_store.h"
+#include "../gfx/chunk.h"
+#include "../gfx/chunk_file.h"
+#include "../gfx/region_file.h"
+#include "manifest_journal.h"
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vx::level_editor {
+    // Seconds between the background flushes of queued saves
+    static constexpr double kSaveFlushIntervalSeconds = 1.0;
+
+    /**
+     * Write-behind persistence for a project's chunks and project file. Saves are snapshotted on the calling thread
+     * and written by a background thread every kSaveFlushIntervalSeconds, repeated saves of a chunk in between
+     * collapse into the last one. The queue owns the project's region files and its blob store, chunks are saved
+     * with their voxels in the blob store so chunks with the same voxels share a single copy.
+     */
+    class SaveQueue {
+    public:
+        SaveQueue(std::filesystem::path gameObjectFolderPath, std::filesystem::path projectFilePath);
+        ~SaveQueue();
+
+        SaveQueue(const SaveQueue &sq) = delete;
+        auto operator=(const SaveQueue &sq) -> SaveQueue & = delete;
+
+        void start();
+
+        /**
+         * Stops the background thread, writing everything still queued.
+         */
+        void stop();
+
+        /**
+         * Writes everything queued so far before returning.
+         */
+        void flush();
+
+        /**
+         * Queues a save of the chunk's current metadata and voxels, replacing any save of it still queued. Voxels
+         * which haven't been loaded yet are read first.
+         */
+        void saveChunk(const gfx::Chunk &chunk, gfx::ChunkCodec codec);
+        void deleteChunk(const uuids::uuid &chunkIdentifier);
+
+        /**
+         * Queues a rewrite of the project file, which includes every manifest record up to `journalSequence`. The
+         * journal keeps only the records after it once the file is written.
+         */
+        void saveProjectFile(std::string contents, u64 journalSequence = 0);
+
+        /**
+         * Queues a record to append to the manifest journal, records are written in the order they are queued.
+         */
+        void appendManifestRecord(ManifestRecord record);
+
+        /**
+         * Reads every chunk in a region file, still serialized (see gfx::decodeChunk) so they can be parsed
+         * elsewhere, with their blobs attached. Different regions can be read from several threads at once.
+         * @param {bool} metadataOnly - Reads only the front of each chunk, as much as gfx::decodeChunkMetadata needs
+         * @return The serialized chunks, or nullopt if the region file is missing or unreadable
+         */
+        auto readRegion(const std::string &fileName, bool metadataOnly = false)
+                -> std::optional<std::vector<std::vector<u8>>>;
+
+        /**
+         * Reads a single chunk from a region file already opened by readRegion, safe to call from any thread.
+         * @return The serialized chunk with its blob attached, or nullopt if the region doesn't hold it
+         */
+        auto readChunk(const std::string &fileName, const uuids::uuid &chunkIdentifier)
+                -> std::optional<std::vector<u8>>;
+
+        /**
+         * Removes the blobs no stored chunk refers to. Only call this once every region of the project has been
+         * read by readRegion, the blobs of chunks in regions it hasn't seen would be removed too.
+         * @return The number of blobs removed
+         */
+        auto collectBlobs() -> usize;
+
+        /**
+         * Chunks, project files and manifest records waiting to be written.
+         */
+        auto pending() -> usize;
+
+    private:
+        struct PendingChunk {
+            // nullopt deletes the chunk
+            std::optional<gfx::Chunk> chunk;
+            gfx::ChunkCodec codec = gfx::kDefaultChunkCodec;
+        };
+
+        struct PendingProjectFile {
+            std::string contents;
+            u64 journalSequence = 0;
+        };
+
+        std::filesystem::path gameObjectFolderPath_;
+        std::filesystem::path projectFilePath_;
+
+        // Guards the queue, only held long enough to add to it or take it
+        std::mutex queueMutex_;
+        std::condition_variable wake_;
+        bool stopping_ = false;
+        std::unordered_map<uuids::uuid, PendingChunk> pendingChunks_;
+        std::optional<PendingProjectFile> pendingProjectFile_;
+        std::vector<ManifestRecord> pendingRecords_;
+
+        // Serializes flushes and guards the region files and blob store
+        std::mutex ioMutex_;
+        std::unordered_map<std::string, gfx::RegionFile> regions_;
+        std::unordered_map<uuids::uuid, std::string> storedRegions_;
+        std::optional<gfx::BlobStore> blobStore_;
+        std::unordered_map<uuids::uuid, util::Hash128> storedBlobs_;
+
+        std::thread worker_;
+
+        void work();
+
+        auto region(const std::string &fileName) -> gfx::RegionFile *;
+
+        /**
+         * The blob store, opened on first use.
+         * @param {bool} create - Creates the store if the project doesn't have one yet
+         */
+        auto blobStore(bool create = true) -> gfx::BlobStore *;
+
+        /**
+         * Attaches the voxels of a chunk kept in the blob store, chunks stored with their voxels pass through.
+         */
+        auto attachBlob(std::vector<u8> record, const std::string &source) -> std::optional<std::vector<u8>>;
+        void persistChunks(const std::string &fileName,
+                           const std::vector<std::pair<uuids::uuid, gfx::ChunkBlob>> &encodedChunks);
+
+        /**
+         * Removes a chunk from the region it is stored in unless that is `keptFileName`, deleting the region file
+         * once it is empty.
+         */
+        void eraseStoredChunk(const uuids::uuid &chunkIdentifier, const std::string &keptFileName);
+        auto writeProjectFile(const std::string &contents) -> bool;
+
+        /**
+         * Appends records to the journal, or replaces its contents with them if `truncate` is set.
+         */
+        void writeJournal(const std::vector<ManifestRecord> &records, bool truncate);
+    };
+}// namespace vx::level_editor
@@ -1,7 +1,23 @@
 #include "settings_menu.h"
+#include "../window.h"
+#include "project.h"
 
 namespace vx::level_editor {
     void showSettingsMenu() {
-        if (ImGui::BeginMenu("Settings")) { ImGui::EndMenu(); }
+        if (ImGui::BeginMenu("Settings")) {
+            ImGui::MenuItem("Render On Demand", nullptr, &renderOnDemand());
+
+            auto &storage = Project::instance()->storage();
+            int budgetMegabytes = static_cast<int>(storage->residency().budget() >> 20);
+            if (ImGui::SliderInt("GPU Budget (MB)", &budgetMegabytes, 64, 8192)) {
+                storage->setGpuBudget(static_cast<u64>(budgetMegabytes) << 20);
+            }
+
+            int chunkCodec = static_cast<int>(Project::instance()->chunkCodec());
+            if (ImGui::Combo("Chunk Compression", &chunkCodec, gfx::kAvailableChunkCodecs.data(), gfx::kChunkCodecs)) {
+                Project::instance()->setChunkCodec(static_cast<gfx::ChunkCodec>(chunkCodec));
+            }
+            ImGui::EndMenu();
+        }
     }
 }// namespace vx::level_editor
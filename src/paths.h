@@ -27,6 +27,9 @@ namespace vx::paths {
     // Standard extension for projects
     inline constexpr auto kXmlPostfix = ".xml";
 
+    // Extension for binary chunk files, older projects store chunks as kXmlPostfix files
+    inline constexpr auto kChunkPostfix = ".vxc";
+
     // Shader modules
     enum ShaderModule { kCore = 0, kDebug };
     inline const std::array<char *, 2> kAvailableShaderModules = {(char *) "core", (char *) "debug"};
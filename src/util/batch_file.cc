@@ -0,0 +1,389 @@
+#include "batch_file.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef VX_IO_URING
+#include <atomic>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace vx::util {
+#ifdef VX_IO_URING
+    // Submission queue entries of each thread's ring, larger batches go through in several rounds
+    static constexpr u32 kIoUringEntries = 64;
+
+    // Size of the buffer registered with each thread's ring, transfers that fit are staged through it
+    static constexpr usize kIoUringStagingBytes = 1 << 20;
+
+    /**
+     * A minimal io_uring driven through the raw syscalls, so no liburing is needed. Only used by the thread that
+     * created it.
+     */
+    class IoUring {
+    public:
+        struct Transfer {
+            u64 offset;
+            u8 *data;
+            u32 length;
+            bool write;
+        };
+
+        IoUring() {
+            io_uring_params params{};
+            descriptor_ = static_cast<int>(syscall(__NR_io_uring_setup, kIoUringEntries, &params));
+            if (descriptor_ < 0) {
+                spdlog::info("io_uring is unavailable ({}), using positional file I/O", std::strerror(errno));
+                return;
+            }
+
+            sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(u32);
+            cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap) { sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_); }
+
+            sqRing_ = mapRing(sqRingSize_, IORING_OFF_SQ_RING);
+            cqRing_ = singleMap ? sqRing_ : mapRing(cqRingSize_, IORING_OFF_CQ_RING);
+            sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe *>(mapRing(sqesSize_, IORING_OFF_SQES));
+            if (sqRing_ == nullptr || cqRing_ == nullptr || sqes_ == nullptr) {
+                spdlog::warn("Failed to map the io_uring rings, using positional file I/O");
+                destroy();
+                return;
+            }
+
+            auto *sq = static_cast<u8 *>(sqRing_);
+            sqHead_ = reinterpret_cast<u32 *>(sq + params.sq_off.head);
+            sqTail_ = reinterpret_cast<u32 *>(sq + params.sq_off.tail);
+            sqMask_ = *reinterpret_cast<u32 *>(sq + params.sq_off.ring_mask);
+            sqArray_ = reinterpret_cast<u32 *>(sq + params.sq_off.array);
+            sqEntries_ = params.sq_entries;
+
+            auto *cq = static_cast<u8 *>(cqRing_);
+            cqHead_ = reinterpret_cast<u32 *>(cq + params.cq_off.head);
+            cqTail_ = reinterpret_cast<u32 *>(cq + params.cq_off.tail);
+            cqMask_ = *reinterpret_cast<u32 *>(cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+            // Staged transfers skip pinning and unpinning their pages on every request. Without it every
+            // transfer goes straight to the caller's memory.
+            void *staging = mmap(nullptr, kIoUringStagingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                                 -1, 0);
+            if (staging != MAP_FAILED) {
+                iovec buffer{staging, kIoUringStagingBytes};
+                if (syscall(__NR_io_uring_register, descriptor_, IORING_REGISTER_BUFFERS, &buffer, 1) == 0) {
+                    staging_ = static_cast<u8 *>(staging);
+                } else {
+                    munmap(staging, kIoUringStagingBytes);
+                }
+            }
+        }
+
+        ~IoUring() { destroy(); }
+
+        IoUring(const IoUring &ring) = delete;
+        auto operator=(const IoUring &ring) -> IoUring & = delete;
+
+        auto valid() const -> bool { return descriptor_ >= 0; }
+
+        // Set once a failed transfer tore the ring down, as opposed to io_uring never being available
+        auto abandoned() const -> bool { return abandoned_; }
+
+        /**
+         * Runs every transfer on `descriptor`, as few submissions as the queue depth and staging buffer allow.
+         * @return Whether every transfer moved all of its bytes
+         */
+        auto transfer(int descriptor, std::span<const Transfer> transfers) -> bool {
+            // Where each in-flight transfer was staged, or kNotStaged
+            constexpr usize kNotStaged = ~usize(0);
+            std::vector<usize> stagedAt;
+            stagedAt.reserve(sqEntries_);
+
+            bool succeeded = true;
+            for (usize next = 0; next < transfers.size();) {
+                const usize first = next;
+                usize stagingUsed = 0;
+                stagedAt.clear();
+
+                const u32 sqHead = std::atomic_ref(*sqHead_).load(std::memory_order_acquire);
+                u32 tail = std::atomic_ref(*sqTail_).load(std::memory_order_relaxed);
+                while (next < transfers.size() && stagedAt.size() < sqEntries_) {
+                    const auto &transfer = transfers[next];
+                    const bool stageable = staging_ != nullptr && transfer.length <= kIoUringStagingBytes;
+                    const bool staged = stageable && transfer.length <= kIoUringStagingBytes - stagingUsed;
+
+                    // Leave a transfer which would fit an empty staging buffer to the next round
+                    if (stageable && !staged) { break; }
+
+                    const u32 index = tail & sqMask_;
+                    io_uring_sqe &sqe = sqes_[index];
+                    std::memset(&sqe, 0, sizeof(sqe));
+                    sqe.fd = descriptor;
+                    sqe.off = transfer.offset;
+                    sqe.len = transfer.length;
+                    sqe.user_data = stagedAt.size();
+                    if (staged) {
+                        sqe.opcode = transfer.write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                        sqe.addr = reinterpret_cast<u64>(staging_ + stagingUsed);
+                        sqe.buf_index = 0;
+                        if (transfer.write) { std::memcpy(staging_ + stagingUsed, transfer.data, transfer.length); }
+                        stagedAt.push_back(stagingUsed);
+                        stagingUsed += transfer.length;
+                    } else {
+                        sqe.opcode = transfer.write ? IORING_OP_WRITE : IORING_OP_READ;
+                        sqe.addr = reinterpret_cast<u64>(transfer.data);
+                        stagedAt.push_back(kNotStaged);
+                    }
+                    sqArray_[index] = index;
+                    ++tail;
+                    ++next;
+                }
+                std::atomic_ref(*sqTail_).store(tail, std::memory_order_release);
+
+                const auto nSubmitted = static_cast<u32>(stagedAt.size());
+                if (syscall(__NR_io_uring_enter, descriptor_, nSubmitted, nSubmitted, IORING_ENTER_GETEVENTS, nullptr,
+                            0) < 0) {
+                    // An interrupted wait has still submitted everything, other failures may leave entries behind
+                    const u32 consumed = std::atomic_ref(*sqHead_).load(std::memory_order_acquire) - sqHead;
+                    if (errno != EINTR || consumed != nSubmitted) {
+                        abandon(consumed);
+                        return false;
+                    }
+                }
+
+                // Reap this round's completions, waiting again if the kernel was interrupted before all were done
+                for (u32 reaped = 0; reaped < nSubmitted;) {
+                    u32 head = std::atomic_ref(*cqHead_).load(std::memory_order_relaxed);
+                    const u32 cqTail = std::atomic_ref(*cqTail_).load(std::memory_order_acquire);
+                    if (head == cqTail) {
+                        if (syscall(__NR_io_uring_enter, descriptor_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                            errno != EINTR) {
+                            abandon(nSubmitted - reaped);
+                            return false;
+                        }
+                        continue;
+                    }
+
+                    for (; head != cqTail; ++head, ++reaped) {
+                        const io_uring_cqe &cqe = cqes_[head & cqMask_];
+                        const auto &transfer = transfers[first + cqe.user_data];
+                        if (cqe.res != static_cast<i32>(transfer.length)) {
+                            succeeded = false;
+                        } else if (!transfer.write && stagedAt.at(cqe.user_data) != kNotStaged) {
+                            std::memcpy(transfer.data, staging_ + stagedAt.at(cqe.user_data), transfer.length);
+                        }
+                    }
+                    std::atomic_ref(*cqHead_).store(head, std::memory_order_release);
+                }
+            }
+            return succeeded;
+        }
+
+    private:
+        int descriptor_ = -1;
+
+        void *sqRing_ = nullptr;
+        void *cqRing_ = nullptr;
+        io_uring_sqe *sqes_ = nullptr;
+        usize sqRingSize_ = 0;
+        usize cqRingSize_ = 0;
+        usize sqesSize_ = 0;
+
+        u32 *sqHead_ = nullptr;
+        u32 *sqTail_ = nullptr;
+        u32 *sqArray_ = nullptr;
+        u32 sqMask_ = 0;
+        u32 sqEntries_ = 0;
+
+        u32 *cqHead_ = nullptr;
+        u32 *cqTail_ = nullptr;
+        u32 cqMask_ = 0;
+        io_uring_cqe *cqes_ = nullptr;
+
+        u8 *staging_ = nullptr;
+        bool abandoned_ = false;
+
+        /**
+         * Gives up on the ring after a failed submission or wait. Entries the kernel already took still point at
+         * the staging buffer or the caller's memory, so they are waited out before returning. The ring is then torn
+         * down, entries it never took would otherwise go out with the next batch, and threadRing builds a new one.
+         * @param {u32} inFlight - Entries taken by the kernel whose completions haven't been reaped
+         */
+        void abandon(u32 inFlight) {
+            while (inFlight > 0) {
+                const u32 head = std::atomic_ref(*cqHead_).load(std::memory_order_relaxed);
+                const u32 cqTail = std::atomic_ref(*cqTail_).load(std::memory_order_acquire);
+                if (head != cqTail) {
+                    inFlight -= std::min(inFlight, cqTail - head);
+                    std::atomic_ref(*cqHead_).store(cqTail, std::memory_order_release);
+                    continue;
+                }
+                if (syscall(__NR_io_uring_enter, descriptor_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                    errno != EINTR) {
+                    spdlog::error("Lost track of {} io_uring transfers ({})", inFlight, std::strerror(errno));
+                    break;
+                }
+            }
+            destroy();
+            abandoned_ = true;
+        }
+
+        auto mapRing(usize size, u64 offset) const -> void * {
+            void *ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor_,
+                              static_cast<off_t>(offset));
+            return ring == MAP_FAILED ? nullptr : ring;
+        }
+
+        void destroy() {
+            if (staging_ != nullptr) { munmap(staging_, kIoUringStagingBytes); }
+            if (sqes_ != nullptr) { munmap(sqes_, sqesSize_); }
+            if (cqRing_ != nullptr && cqRing_ != sqRing_) { munmap(cqRing_, cqRingSize_); }
+            if (sqRing_ != nullptr) { munmap(sqRing_, sqRingSize_); }
+            if (descriptor_ >= 0) { close(descriptor_); }
+            staging_ = nullptr;
+            sqes_ = nullptr;
+            cqRing_ = sqRing_ = nullptr;
+            descriptor_ = -1;
+        }
+    };
+
+    /**
+     * The calling thread's ring, or nullptr if io_uring can't be used. A ring abandoned by a failed transfer is
+     * replaced with a fresh one.
+     */
+    static auto threadRing() -> IoUring * {
+        thread_local auto ring = std::make_unique<IoUring>();
+        if (ring->abandoned()) { ring = std::make_unique<IoUring>(); }
+        return ring->valid() ? ring.get() : nullptr;
+    }
+#endif
+
+    BatchFile::BatchFile(BatchFile &&other) noexcept { *this = std::move(other); }
+
+    auto BatchFile::operator=(BatchFile &&other) noexcept -> BatchFile & {
+#ifdef _WIN32
+        file_ = std::move(other.file_);
+#else
+        std::swap(descriptor_, other.descriptor_);
+#endif
+        return *this;
+    }
+
+    BatchFile::~BatchFile() {
+#ifndef _WIN32
+        if (descriptor_ >= 0) { close(descriptor_); }
+#endif
+    }
+
+    auto BatchFile::open(const std::filesystem::path &path, bool create) -> std::optional<BatchFile> {
+        BatchFile file;
+#ifdef _WIN32
+        if (create && !std::filesystem::exists(path)) { std::ofstream(path, std::ios::binary); }
+        file.file_.open(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file.file_) { return std::nullopt; }
+#else
+        file.descriptor_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+        if (file.descriptor_ < 0) { return std::nullopt; }
+#endif
+        return file;
+    }
+
+    auto BatchFile::read(std::span<const FileRead> reads) -> bool {
+#ifdef VX_IO_URING
+        if (auto *ring = threadRing(); ring != nullptr && reads.size() > 1) {
+            std::vector<IoUring::Transfer> transfers;
+            transfers.reserve(reads.size());
+            for (const auto &[offset, buffer] : reads) {
+                transfers.push_back({offset, buffer.data(), static_cast<u32>(buffer.size()), false});
+            }
+            if (ring->transfer(descriptor_, transfers)) { return true; }
+        }
+#endif
+        return readPositional(reads);
+    }
+
+    auto BatchFile::write(std::span<const FileWrite> writes) -> bool {
+#ifdef VX_IO_URING
+        if (auto *ring = threadRing(); ring != nullptr && writes.size() > 1) {
+            std::vector<IoUring::Transfer> transfers;
+            transfers.reserve(writes.size());
+            for (const auto &[offset, bytes] : writes) {
+                transfers.push_back({offset, const_cast<u8 *>(bytes.data()), static_cast<u32>(bytes.size()), true});
+            }
+            if (ring->transfer(descriptor_, transfers)) { return true; }
+        }
+#endif
+        return writePositional(writes);
+    }
+
+    auto BatchFile::size() -> u64 {
+#ifdef _WIN32
+        file_.clear();
+        file_.seekg(0, std::ios::end);
+        return static_cast<u64>(file_.tellg());
+#else
+        struct stat status {};
+        return fstat(descriptor_, &status) == 0 ? static_cast<u64>(status.st_size) : 0;
+#endif
+    }
+
+    auto BatchFile::backend() -> FileIoBackend {
+#ifdef VX_IO_URING
+        if (threadRing() != nullptr) { return FileIoBackend::kIoUring; }
+#endif
+        return FileIoBackend::kPositional;
+    }
+
+    auto BatchFile::readPositional(std::span<const FileRead> reads) -> bool {
+        for (const auto &[offset, buffer] : reads) {
+#ifdef _WIN32
+            file_.clear();
+            file_.seekg(static_cast<std::streamoff>(offset));
+            if (!file_.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+                return false;
+            }
+#else
+            for (usize done = 0; done < buffer.size();) {
+                const auto n = pread(descriptor_, buffer.data() + done, buffer.size() - done,
+                                     static_cast<off_t>(offset + done));
+                if (n < 0 && errno == EINTR) { continue; }
+                if (n <= 0) { return false; }
+                done += static_cast<usize>(n);
+            }
+#endif
+        }
+        return true;
+    }
+
+    auto BatchFile::writePositional(std::span<const FileWrite> writes) -> bool {
+        for (const auto &[offset, bytes] : writes) {
+#ifdef _WIN32
+            file_.clear();
+            file_.seekp(static_cast<std::streamoff>(offset));
+            const auto length = static_cast<std::streamsize>(bytes.size());
+            if (!file_.write(reinterpret_cast<const char *>(bytes.data()), length)) { return false; }
+            file_.flush();
+#else
+            for (usize done = 0; done < bytes.size();) {
+                const auto n = pwrite(descriptor_, bytes.data() + done, bytes.size() - done,
+                                      static_cast<off_t>(offset + done));
+                if (n < 0 && errno == EINTR) { continue; }
+                if (n <= 0) { return false; }
+                done += static_cast<usize>(n);
+            }
+#endif
+        }
+        return true;
+    }
+}// namespace vx::util
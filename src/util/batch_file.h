@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../math.h"
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+
+namespace vx::util {
+    struct FileRead {
+        u64 offset = 0;
+        std::span<u8> buffer;
+    };
+
+    struct FileWrite {
+        u64 offset = 0;
+        std::span<const u8> bytes;
+    };
+
+    enum class FileIoBackend {
+        // Batches go to the kernel through a per-thread io_uring (when built with VX_IO_URING)
+        kIoUring,
+        // One positional read or write per request
+        kPositional,
+    };
+
+    /**
+     * A file open for batched positional reads and writes. On Linux builds with VX_IO_URING a whole batch is
+     * submitted to the calling thread's io_uring at once, small transfers are staged through a buffer registered
+     * with the ring. Anywhere io_uring can't be set up, and for any batch it fails, each request is a plain
+     * positional read or write instead.
+     */
+    class BatchFile {
+    public:
+        BatchFile(BatchFile &&other) noexcept;
+        auto operator=(BatchFile &&other) noexcept -> BatchFile &;
+        ~BatchFile();
+
+        BatchFile(const BatchFile &bf) = delete;
+        auto operator=(const BatchFile &bf) -> BatchFile & = delete;
+
+        /**
+         * Opens a file for reading and writing, creating it if `create` is set and it doesn't exist.
+         * @return The file, or nullopt if it could not be opened
+         */
+        static auto open(const std::filesystem::path &path, bool create = false) -> std::optional<BatchFile>;
+
+        /**
+         * Fills every request's buffer from the file.
+         * @return Whether every buffer was filled completely
+         */
+        auto read(std::span<const FileRead> reads) -> bool;
+
+        /**
+         * Writes every request's bytes, extending the file as needed.
+         * @return Whether every request was written completely
+         */
+        auto write(std::span<const FileWrite> writes) -> bool;
+
+        auto size() -> u64;
+
+        /**
+         * The backend batches issued from the calling thread go to.
+         */
+        static auto backend() -> FileIoBackend;
+
+    private:
+        BatchFile() = default;
+
+#ifdef _WIN32
+        std::fstream file_;
+#else
+        int descriptor_ = -1;
+#endif
+
+        auto readPositional(std::span<const FileRead> reads) -> bool;
+        auto writePositional(std::span<const FileWrite> writes) -> bool;
+    };
+}// namespace vx::util
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../math.h"
+#include <type_traits>
+
+namespace vx::util {
+    /**
+     * Stores an integer at `destination` in little-endian byte order, regardless of the host's.
+     */
+    template<typename T>
+    void putLittleEndian(u8 *destination, T value) {
+        using Bits = std::make_unsigned_t<T>;
+        const auto bits = static_cast<Bits>(value);
+        for (usize ii = 0; ii < sizeof(T); ++ii) { destination[ii] = static_cast<u8>(bits >> (8 * ii)); }
+    }
+
+    /**
+     * Loads a little-endian integer from `source`.
+     */
+    template<typename T>
+    auto getLittleEndian(const u8 *source) -> T {
+        using Bits = std::make_unsigned_t<T>;
+        Bits bits = 0;
+        for (usize ii = 0; ii < sizeof(T); ++ii) { bits |= static_cast<Bits>(source[ii]) << (8 * ii); }
+        return static_cast<T>(bits);
+    }
+}// namespace vx::util
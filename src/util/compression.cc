@@ -0,0 +1,195 @@
+#include "compression.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace vx::util {
+    // LZ4 block format limits: matches are at least kLzMinMatch bytes, the last kLzLastLiterals bytes are always
+    // literals and no match starts within kLzMatchStartLimit bytes of the end.
+    static constexpr usize kLzMinMatch = 4;
+    static constexpr usize kLzLastLiterals = 5;
+    static constexpr usize kLzMatchStartLimit = 12;
+    static constexpr usize kLzMaxOffset = 65535;
+    static constexpr u32 kLzHashBits = 12;
+
+    // Misses in a row before the matcher starts skipping ahead, so incompressible data is passed over quickly
+    static constexpr u32 kLzSkipStrength = 6;
+
+    auto runLengthEncode(std::span<const u8> input) -> std::vector<u8> {
+        std::vector<u8> output;
+        for (usize ii = 0; ii < input.size();) {
+            const u8 value = input[ii];
+            usize run = 1;
+            while (ii + run < input.size() && input[ii + run] == value) { ++run; }
+            ii += run;
+
+            output.push_back(value);
+            for (; run >= 0x80; run >>= 7) { output.push_back(static_cast<u8>(run | 0x80)); }
+            output.push_back(static_cast<u8>(run));
+        }
+        return output;
+    }
+
+    /**
+     * Reads the varint run length following a run's value at `ii`, moving `ii` past it.
+     */
+    static auto readRun(std::span<const u8> input, usize &ii, u64 &run) -> bool {
+        run = 0;
+        for (u32 shift = 0;; shift += 7) {
+            if (ii == input.size() || shift >= 64) { return false; }
+            const u8 byte = input[ii++];
+            run |= static_cast<u64>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) { return true; }
+        }
+    }
+
+    auto runLengthDecode(std::span<const u8> input, std::span<u8> output) -> bool {
+        usize written = 0;
+        for (usize ii = 0; ii < input.size();) {
+            const u8 value = input[ii++];
+
+            u64 run = 0;
+            if (!readRun(input, ii, run)) { return false; }
+
+            if (run > output.size() - written) { return false; }
+            std::fill_n(output.begin() + written, run, value);
+            written += run;
+        }
+        return written == output.size();
+    }
+
+    auto runLengthDecodedSize(std::span<const u8> input) -> std::optional<u64> {
+        u64 size = 0;
+        for (usize ii = 0; ii < input.size();) {
+            ++ii;
+            u64 run = 0;
+            if (!readRun(input, ii, run) || run > std::numeric_limits<u64>::max() - size) { return std::nullopt; }
+            size += run;
+        }
+        return size;
+    }
+
+    static auto read32(const u8 *source) -> u32 {
+        u32 value;
+        std::memcpy(&value, source, sizeof(value));
+        return value;
+    }
+
+    static auto lzHash(u32 sequence) -> u32 { return (sequence * 2654435761u) >> (32 - kLzHashBits); }
+
+    static void writeLength(std::vector<u8> &output, usize length) {
+        for (; length >= 255; length -= 255) { output.push_back(255); }
+        output.push_back(static_cast<u8>(length));
+    }
+
+    static void writeSequence(std::vector<u8> &output, std::span<const u8> literals, usize offset, usize matchLength) {
+        const usize extraMatch = matchLength - kLzMinMatch;
+        const usize token = (std::min<usize>(literals.size(), 15) << 4) | std::min<usize>(extraMatch, 15);
+        output.push_back(static_cast<u8>(token));
+        if (literals.size() >= 15) { writeLength(output, literals.size() - 15); }
+        output.insert(output.end(), literals.begin(), literals.end());
+
+        output.push_back(static_cast<u8>(offset));
+        output.push_back(static_cast<u8>(offset >> 8));
+        if (extraMatch >= 15) { writeLength(output, extraMatch - 15); }
+    }
+
+    auto lzCompress(std::span<const u8> input) -> std::vector<u8> {
+        std::vector<u8> output;
+        output.reserve(input.size() + input.size() / 255 + 16);
+
+        // Last position (plus one, zero is empty) each hashed 4 byte sequence was seen at
+        std::vector<usize> table(1 << kLzHashBits, 0);
+
+        const u8 *bytes = input.data();
+        usize anchor = 0;
+        usize position = 0;
+        u32 misses = 0;
+        while (position + kLzMatchStartLimit <= input.size()) {
+            const u32 sequence = read32(bytes + position);
+            auto &entry = table[lzHash(sequence)];
+            const usize candidate = entry;
+            entry = position + 1;
+
+            if (candidate == 0 || position - (candidate - 1) > kLzMaxOffset ||
+                read32(bytes + candidate - 1) != sequence) {
+                position += 1 + (misses++ >> kLzSkipStrength);
+                continue;
+            }
+            misses = 0;
+
+            usize match = candidate - 1;
+            usize length = kLzMinMatch;
+            const usize matchEndLimit = input.size() - kLzLastLiterals;
+            while (position + length < matchEndLimit && bytes[match + length] == bytes[position + length]) { ++length; }
+
+            // Pull the match back over literals that also match
+            while (position > anchor && match > 0 && bytes[position - 1] == bytes[match - 1]) {
+                --position;
+                --match;
+                ++length;
+            }
+
+            writeSequence(output, input.subspan(anchor, position - anchor), position - match, length);
+            position += length;
+            anchor = position;
+        }
+
+        // The block always ends with a literal-only sequence
+        const usize nLiterals = input.size() - anchor;
+        output.push_back(static_cast<u8>(std::min<usize>(nLiterals, 15) << 4));
+        if (nLiterals >= 15) { writeLength(output, nLiterals - 15); }
+        output.insert(output.end(), input.begin() + static_cast<std::ptrdiff_t>(anchor), input.end());
+        return output;
+    }
+
+    static auto readLength(std::span<const u8> input, usize &ii, usize &length) -> bool {
+        u8 byte;
+        do {
+            if (ii == input.size()) { return false; }
+            byte = input[ii++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    auto lzDecompress(std::span<const u8> input, std::span<u8> output) -> bool {
+        usize ii = 0;
+        usize written = 0;
+        while (ii < input.size()) {
+            const u8 token = input[ii++];
+
+            usize nLiterals = token >> 4;
+            if (nLiterals == 15 && !readLength(input, ii, nLiterals)) { return false; }
+            if (nLiterals > input.size() - ii || nLiterals > output.size() - written) { return false; }
+            std::copy_n(input.data() + ii, nLiterals, output.data() + written);
+            ii += nLiterals;
+            written += nLiterals;
+
+            // The last sequence has no match
+            if (ii == input.size()) { break; }
+
+            if (input.size() - ii < 2) { return false; }
+            const usize offset = input[ii] | static_cast<usize>(input[ii + 1]) << 8;
+            ii += 2;
+            if (offset == 0 || offset > written) { return false; }
+
+            usize matchLength = token & 15;
+            if (matchLength == 15 && !readLength(input, ii, matchLength)) { return false; }
+            matchLength += kLzMinMatch;
+            if (matchLength > output.size() - written) { return false; }
+
+            // Overlapping matches repeat the last `offset` bytes. Copying whole periods at a time, doubling each
+            // step, keeps every memcpy free of overlap.
+            u8 *destination = output.data() + written;
+            const u8 *source = destination - offset;
+            for (usize copied = 0; copied < matchLength;) {
+                const usize n = std::min(matchLength - copied, offset + copied);
+                std::memcpy(destination + copied, source, n);
+                copied += n;
+            }
+            written += matchLength;
+        }
+        return written == output.size();
+    }
+}// namespace vx::util
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../math.h"
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace vx::util {
+    /**
+     * Run-length encodes bytes as (value, run length) pairs, the run length as a LEB128 varint.
+     */
+    auto runLengthEncode(std::span<const u8> input) -> std::vector<u8>;
+
+    /**
+     * Decodes runLengthEncode output into `output`.
+     * @return Whether the input was well formed and decoded to exactly output.size() bytes
+     */
+    auto runLengthDecode(std::span<const u8> input, std::span<u8> output) -> bool;
+
+    /**
+     * The number of bytes runLengthEncode output decodes to, found without decoding it.
+     * @return The size, or nullopt if the input is malformed or its runs add up past u64
+     */
+    auto runLengthDecodedSize(std::span<const u8> input) -> std::optional<u64>;
+
+    /**
+     * Compresses bytes in the LZ4 block format with a greedy single-probe matcher over a 64KB window, tuned for
+     * decompression speed rather than ratio.
+     */
+    auto lzCompress(std::span<const u8> input) -> std::vector<u8>;
+
+    /**
+     * Decompresses an LZ4 block into `output`, never reading or writing out of bounds on malformed input.
+     * @return Whether the block was well formed and decompressed to exactly output.size() bytes
+     */
+    auto lzDecompress(std::span<const u8> input, std::span<u8> output) -> bool;
+
+    /**
+     * The most bytes an LZ4 block of `inputSize` bytes can decompress to, each input byte extends a match by at
+     * most 255 bytes.
+     */
+    inline auto lzDecompressBound(usize inputSize) -> u64 { return 255ull * inputSize; }
+}// namespace vx::util
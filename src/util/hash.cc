@@ -0,0 +1,85 @@
+#include "hash.h"
+#include "bytes.h"
+#include <bit>
+#include <cstdio>
+
+namespace vx::util {
+    static constexpr u64 kPrime1 = 11400714785074694791ull;
+    static constexpr u64 kPrime2 = 14029467366897019727ull;
+    static constexpr u64 kPrime3 = 1609587929392839161ull;
+    static constexpr u64 kPrime4 = 9650029242287828579ull;
+    static constexpr u64 kPrime5 = 2870177450012600261ull;
+
+    // Seed of the high half of a content hash, any value other than the low half's 0 will do
+    static constexpr u64 kHighSeed = 0x9e3779b97f4a7c15ull;
+
+    static auto round(u64 accumulator, u64 input) -> u64 {
+        accumulator += input * kPrime2;
+        return std::rotl(accumulator, 31) * kPrime1;
+    }
+
+    static auto mergeRound(u64 hash, u64 accumulator) -> u64 {
+        hash ^= round(0, accumulator);
+        return hash * kPrime1 + kPrime4;
+    }
+
+    auto Hash128::toString() const -> std::string {
+        std::string digits(32, '0');
+        std::snprintf(digits.data(), digits.size() + 1, "%016llx%016llx", static_cast<unsigned long long>(high),
+                      static_cast<unsigned long long>(low));
+        return digits;
+    }
+
+    auto xxHash64(std::span<const u8> bytes, u64 seed) -> u64 {
+        const u8 *input = bytes.data();
+        const u8 *const end = input + bytes.size();
+
+        u64 hash;
+        if (bytes.size() >= 32) {
+            // Four independent lanes over 32 byte stripes
+            u64 lane1 = seed + kPrime1 + kPrime2;
+            u64 lane2 = seed + kPrime2;
+            u64 lane3 = seed;
+            u64 lane4 = seed - kPrime1;
+            for (; end - input >= 32; input += 32) {
+                lane1 = round(lane1, getLittleEndian<u64>(input));
+                lane2 = round(lane2, getLittleEndian<u64>(input + 8));
+                lane3 = round(lane3, getLittleEndian<u64>(input + 16));
+                lane4 = round(lane4, getLittleEndian<u64>(input + 24));
+            }
+
+            hash = std::rotl(lane1, 1) + std::rotl(lane2, 7) + std::rotl(lane3, 12) + std::rotl(lane4, 18);
+            hash = mergeRound(hash, lane1);
+            hash = mergeRound(hash, lane2);
+            hash = mergeRound(hash, lane3);
+            hash = mergeRound(hash, lane4);
+        } else {
+            hash = seed + kPrime5;
+        }
+        hash += bytes.size();
+
+        for (; end - input >= 8; input += 8) {
+            hash ^= round(0, getLittleEndian<u64>(input));
+            hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+        }
+        if (end - input >= 4) {
+            hash ^= static_cast<u64>(getLittleEndian<u32>(input)) * kPrime1;
+            hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+            input += 4;
+        }
+        for (; input < end; ++input) {
+            hash ^= *input * kPrime5;
+            hash = std::rotl(hash, 11) * kPrime1;
+        }
+
+        // Avalanche
+        hash ^= hash >> 33;
+        hash *= kPrime2;
+        hash ^= hash >> 29;
+        hash *= kPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    auto contentHash(std::span<const u8> bytes) -> Hash128 { return {xxHash64(bytes), xxHash64(bytes, kHighSeed)}; }
+}// namespace vx::util
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../math.h"
+#include <functional>
+#include <span>
+#include <string>
+
+namespace vx::util {
+    /**
+     * A 128 bit content hash, two xxHash64 digests of the same bytes with different seeds.
+     */
+    struct Hash128 {
+        u64 low = 0;
+        u64 high = 0;
+
+        auto operator==(const Hash128 &other) const -> bool = default;
+
+        /**
+         * 32 lowercase hex digits, high half first.
+         */
+        auto toString() const -> std::string;
+    };
+
+    /**
+     * xxHash64 (XXH64) of `bytes`, matching the reference implementation's output.
+     */
+    auto xxHash64(std::span<const u8> bytes, u64 seed = 0) -> u64;
+
+    /**
+     * Hashes bytes for content addressing, collisions are negligible at any number of blobs a project holds.
+     */
+    auto contentHash(std::span<const u8> bytes) -> Hash128;
+}// namespace vx::util
+
+template<>
+struct std::hash<vx::util::Hash128> {
+    auto operator()(const vx::util::Hash128 &hash) const noexcept -> std::size_t { return hash.low; }
+};
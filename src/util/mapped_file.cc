@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#define VX_MAPPED_FILE_READ_FALLBACK 1
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vx::util {
+    MappedFile::~MappedFile() {
+#ifndef VX_MAPPED_FILE_READ_FALLBACK
+        if (data_ != nullptr) { munmap(const_cast<u8 *>(data_), size_); }
+#endif
+    }
+
+    auto MappedFile::open(const std::filesystem::path &path) -> std::shared_ptr<const MappedFile> {
+        // Constructor is private, so make_shared can't be used
+        std::shared_ptr<MappedFile> mappedFile(new MappedFile());
+
+#ifdef VX_MAPPED_FILE_READ_FALLBACK
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            spdlog::error("Failed to open {}", path.string());
+            return nullptr;
+        }
+
+        mappedFile->contents_.resize(static_cast<usize>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char *>(mappedFile->contents_.data()),
+                       static_cast<std::streamsize>(mappedFile->contents_.size()))) {
+            spdlog::error("Failed to read {}", path.string());
+            return nullptr;
+        }
+        mappedFile->data_ = mappedFile->contents_.data();
+        mappedFile->size_ = mappedFile->contents_.size();
+#else
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            spdlog::error("Failed to open {}", path.string());
+            return nullptr;
+        }
+
+        struct stat status {};
+        if (fstat(descriptor, &status) != 0) {
+            spdlog::error("Failed to stat {}", path.string());
+            close(descriptor);
+            return nullptr;
+        }
+
+        mappedFile->size_ = static_cast<usize>(status.st_size);
+        if (mappedFile->size_ > 0) {
+            void *data = mmap(nullptr, mappedFile->size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (data == MAP_FAILED) {
+                spdlog::error("Failed to map {}", path.string());
+                close(descriptor);
+                return nullptr;
+            }
+            mappedFile->data_ = static_cast<const u8 *>(data);
+        }
+
+        // The mapping stays valid without the descriptor
+        close(descriptor);
+#endif
+
+        return mappedFile;
+    }
+}// namespace vx::util
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../math.h"
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace vx::util {
+    /**
+     * A read-only view of a whole file. The file is memory mapped where the platform allows it, so pages are only
+     * read when touched and are shared with the OS page cache. Elsewhere the file is read into memory up front.
+     *
+     * A mapping keeps the file's contents as they were when it was opened as long as the file is replaced (written
+     * elsewhere and renamed over) instead of being truncated and rewritten in place.
+     */
+    class MappedFile {
+    public:
+        ~MappedFile();
+
+        MappedFile(const MappedFile &mf) = delete;
+        auto operator=(const MappedFile &mf) -> MappedFile & = delete;
+
+        /**
+         * @return The mapped file, or nullptr if it could not be opened
+         */
+        static auto open(const std::filesystem::path &path) -> std::shared_ptr<const MappedFile>;
+
+        auto bytes() const -> std::span<const u8> { return {data_, size_}; }
+        auto size() const -> usize { return size_; }
+
+    private:
+        MappedFile() = default;
+
+        const u8 *data_ = nullptr;
+        usize size_ = 0;
+
+        // Holds the contents when the file could not be mapped
+        std::vector<u8> contents_;
+    };
+}// namespace vx::util
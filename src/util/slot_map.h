@@ -0,0 +1,170 @@
+#pragma once
+
+#include "../math.h"
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace vx::util {
+    /**
+     * A stable 32 bit reference to a value in a SlotMap. The low kIndexBits bits pick the slot, the rest hold the
+     * slot's generation, which changes every time the slot's value is erased, so a handle outliving its value is
+     * recognised instead of reaching whatever took the slot next.
+     */
+    class SlotHandle {
+    public:
+        static constexpr int kIndexBits = 20;
+        static constexpr u32 kIndexMask = (1u << kIndexBits) - 1;
+        static constexpr u32 kMaxGeneration = (1u << (32 - kIndexBits)) - 1;
+
+        // Slot kIndexMask is never handed out, so this matches no value
+        static constexpr u32 kInvalid = ~0u;
+
+        SlotHandle() = default;
+        SlotHandle(u32 index, u32 generation) : value_((generation << kIndexBits) | index) {}
+
+        auto index() const -> u32 { return value_ & kIndexMask; }
+        auto generation() const -> u32 { return value_ >> kIndexBits; }
+        auto value() const -> u32 { return value_; }
+        auto valid() const -> bool { return value_ != kInvalid; }
+
+        auto operator==(const SlotHandle &other) const -> bool = default;
+
+    private:
+        u32 value_ = kInvalid;
+    };
+
+    /**
+     * Values addressed by SlotHandles. The values are kept contiguous, in no particular order, for iteration, and
+     * lookups index the slot array. Erasing moves the last value into the hole, so references to values only
+     * last until the next insertion or erasure while handles stay valid until their own value is erased.
+     */
+    template<typename T>
+    class SlotMap {
+    public:
+        template<typename... Args>
+        auto emplace(Args &&...args) -> SlotHandle {
+            if (freeSlot_ == kNoSlot) {
+                if (slots_.size() == SlotHandle::kIndexMask) { throw std::length_error("SlotMap has no slots left"); }
+                freeSlot_ = static_cast<u32>(slots_.size());
+                slots_.emplace_back();
+            }
+
+            // The slot only leaves the free list once the value is in place
+            values_.emplace_back(std::forward<Args>(args)...);
+            const u32 index = freeSlot_;
+            auto &slot = slots_.at(index);
+            freeSlot_ = slot.nextFree;
+
+            slot.value = static_cast<u32>(values_.size() - 1);
+            handles_.emplace_back(index, slot.generation);
+            return handles_.back();
+        }
+
+        auto insert(T value) -> SlotHandle { return emplace(std::move(value)); }
+
+        /**
+         * Removes a value, handles to it are stale from then on.
+         * @return Whether the handle referred to a value
+         */
+        auto erase(SlotHandle handle) -> bool {
+            if (!contains(handle)) { return false; }
+
+            auto &slot = slots_.at(handle.index());
+            const u32 value = slot.value;
+            if (value != values_.size() - 1) {
+                values_.at(value) = std::move(values_.back());
+                handles_.at(value) = handles_.back();
+                slots_.at(handles_.at(value).index()).value = value;
+            }
+            values_.pop_back();
+            handles_.pop_back();
+
+            // A slot which ran out of generations is retired, reusing it could make an old handle valid again
+            slot.value = kNoSlot;
+            if (slot.generation < SlotHandle::kMaxGeneration) {
+                ++slot.generation;
+                slot.nextFree = freeSlot_;
+                freeSlot_ = handle.index();
+            }
+            return true;
+        }
+
+        auto contains(SlotHandle handle) const -> bool {
+            if (handle.index() >= slots_.size()) { return false; }
+            const auto &slot = slots_.at(handle.index());
+            return slot.value != kNoSlot && slot.generation == handle.generation();
+        }
+
+        /**
+         * The value a handle refers to, nullptr if the handle is stale or invalid.
+         */
+        auto get(SlotHandle handle) -> T * {
+            return contains(handle) ? &values_.at(slots_.at(handle.index()).value) : nullptr;
+        }
+        auto get(SlotHandle handle) const -> const T * {
+            return contains(handle) ? &values_.at(slots_.at(handle.index()).value) : nullptr;
+        }
+
+        /**
+         * The value a handle refers to, throwing std::out_of_range if the handle is stale or invalid.
+         */
+        auto at(SlotHandle handle) -> T & { return values_.at(checkedValue(handle)); }
+        auto at(SlotHandle handle) const -> const T & { return values_.at(checkedValue(handle)); }
+
+        void reserve(usize capacity) {
+            values_.reserve(capacity);
+            handles_.reserve(capacity);
+        }
+
+        void clear() {
+            // Erasing one by one moves every slot a generation on, so no handle survives the clear
+            while (!handles_.empty()) { erase(handles_.back()); }
+        }
+
+        auto size() const -> usize { return values_.size(); }
+        auto empty() const -> bool { return values_.empty(); }
+
+        /**
+         * The values, contiguous, and at the same positions the handles referring to them.
+         */
+        auto values() -> std::vector<T> & { return values_; }
+        auto values() const -> const std::vector<T> & { return values_; }
+        auto handles() const -> const std::vector<SlotHandle> & { return handles_; }
+
+        auto begin() { return values_.begin(); }
+        auto end() { return values_.end(); }
+        auto begin() const { return values_.begin(); }
+        auto end() const { return values_.end(); }
+
+    private:
+        static constexpr u32 kNoSlot = ~0u;
+
+        struct Slot {
+            // Position of the slot's value in values_, kNoSlot while the slot is free
+            u32 value = kNoSlot;
+            u32 generation = 0;
+
+            // Next slot on the free list
+            u32 nextFree = kNoSlot;
+        };
+
+        std::vector<T> values_;
+        std::vector<SlotHandle> handles_;
+        std::vector<Slot> slots_;
+
+        // Head of the free list, slots are reused most recently freed first
+        u32 freeSlot_ = kNoSlot;
+
+        auto checkedValue(SlotHandle handle) const -> u32 {
+            if (!contains(handle)) { throw std::out_of_range("Stale or invalid SlotHandle"); }
+            return slots_.at(handle.index()).value;
+        }
+    };
+}// namespace vx::util
+
+template<>
+struct std::hash<vx::util::SlotHandle> {
+    auto operator()(const vx::util::SlotHandle &handle) const noexcept -> std::size_t { return handle.value(); }
+};
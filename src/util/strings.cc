@@ -1,5 +1,4 @@
 #include "strings.h"
-#include "../gfx/glfw.h"
 
 namespace vx::util {
     auto charVecToString(const std::vector<char> &charVec) -> std::string { return {charVec.begin(), charVec.end()}; }
@@ -0,0 +1,51 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace vx::util {
+    ThreadPool::ThreadPool(usize nThreads) {
+        workers_.reserve(nThreads);
+        for (usize ii = 0; ii < nThreads; ++ii) { workers_.emplace_back([this]() { work(); }); }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+
+        // Workers drain the queue before exiting so no future is left without a value.
+        for (auto &worker : workers_) { worker.join(); }
+    }
+
+    auto ThreadPool::instance() -> ThreadPool * {
+        // hardware_concurrency() may report 0 when it cannot tell
+        static std::unique_ptr<ThreadPool> threadPool =
+                std::make_unique<ThreadPool>(std::max<usize>(2, std::thread::hardware_concurrency()) - 1);
+        return threadPool.get();
+    }
+
+    void ThreadPool::enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push(std::move(task));
+            ++activeTasks_;
+        }
+        condition_.notify_one();
+    }
+
+    void ThreadPool::work() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) { return; }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+            --activeTasks_;
+        }
+    }
+}// namespace vx::util
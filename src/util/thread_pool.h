@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../math.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vx::util {
+    class ThreadPool {
+    public:
+        explicit ThreadPool(usize nThreads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &tp) = delete;
+        auto operator=(const ThreadPool &tp) -> ThreadPool & = delete;
+
+        /**
+         * Shared pool for background work, sized to leave one core for the main thread.
+         */
+        static auto instance() -> ThreadPool *;
+
+        /**
+         * Queue a job on the pool.
+         * @param {Fn} fn - The job, it must own (or outlive) every piece of data it touches
+         * @return A future for the job's result, dropping it does not block or cancel the job
+         */
+        template<typename Fn>
+        auto submit(Fn &&fn) -> std::future<std::invoke_result_t<Fn>> {
+            using Result = std::invoke_result_t<Fn>;
+            // packaged_task is move-only, share it so it fits in a std::function
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+            auto future = task->get_future();
+            enqueue([task]() { (*task)(); });
+            return future;
+        }
+
+        auto size() const -> usize { return workers_.size(); }
+
+        /**
+         * Jobs queued or running right now.
+         */
+        auto activeTasks() const -> usize { return activeTasks_.load(); }
+
+    private:
+        bool stopping_ = false;
+        std::atomic<usize> activeTasks_ = 0;
+
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::queue<std::function<void()>> tasks_;
+        std::vector<std::thread> workers_;
+
+        void enqueue(std::function<void()> task);
+        void work();
+    };
+
+    template<typename T>
+    inline auto isReady(const std::future<T> &future) -> bool {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+}// namespace vx::util
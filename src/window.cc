@@ -4,6 +4,7 @@
 #include "ctrl/mouse_input.h"
 #include "gfx/block.h"
 #include "gfx/chunk_storage.h"
+#include "gfx/frame_pacer.h"
 #include "gui/menu_bar.h"
 #include "gui/styles.h"
 #include "imgui_multiplatform/imgui.h"
@@ -14,6 +15,8 @@
 #include "paths.h"
 #include "resources.h"
 #include "trigonometry.h"
+#include "util/thread_pool.h"
+#include "widgets/imgui_toast.h"
 #include <imgui_impl_glfw.h>
 #include <spdlog/spdlog.h>
 
@@ -25,31 +28,40 @@ namespace vx {
     static std::unique_ptr<gui::Menubar> menubar = std::make_unique<gui::Menubar>();
     static bgfx::Init init;
     static ivec2 windowDimensions(1280, 720);
+    static gfx::FramePacer framePacer;
+    static bool renderOnDemandEnabled = false;
 
     static void glfwErrorCallback(int err, const char *msg) { spdlog::error("GLFW Error {}: {}", err, msg); }
 
     static void glfwCursorPosCallback([[maybe_unused]] GLFWwindow *_window, double xpos, double ypos) {
         input->handleCursorPos(xpos, ypos, camera);
+        framePacer.requestFrames();
     }
 
     static void glfwMouseButtonCallback(GLFWwindow *_window, int button, int action, int mods) {
         if (!ImGui::GetIO().WantCaptureMouse) { input->handleMouseButtonPress(_window, button, action, mods, camera); }
+        framePacer.requestFrames();
     }
 
     static void glfwKeyCallback([[maybe_unused]] GLFWwindow *_window, int key, int scancode, int action, int mods) {
         ctrl::KeyInput::getInstance()->handleKeyPressEvent(key, scancode, action, mods);
+        framePacer.requestFrames();
     }
 
     static void glfwScrollCallback([[maybe_unused]] GLFWwindow *_window, double xoffset, double yoffset) {
         input->handleScrollEvent(xoffset, yoffset, camera);
+        framePacer.requestFrames();
     }
 
     static void glfwResizeCallback([[maybe_unused]] GLFWwindow *_window, int width, int height) {
         spdlog::debug("Resizing w: {}, h: {}", width, height);
         bgfx::reset(width, height, BGFX_RESET_VSYNC, init.resolution.format);
         camera->resize(width, height);
+        framePacer.requestFrames();
     }
 
+    static void glfwRefreshCallback([[maybe_unused]] GLFWwindow *_window) { framePacer.requestFrames(); }
+
     static void *glfwNativeWindowHandle(GLFWwindow *_window) {
 #if BX_PLATFORM_LINUX || BX_PLATFORM_BSD
 #if ENTRY_CONFIG_USE_WAYLAND
@@ -143,14 +155,15 @@ namespace vx {
         glfwSetScrollCallback(window, glfwScrollCallback);
         glfwSetWindowSizeCallback(window, glfwResizeCallback);
         glfwSetKeyCallback(window, glfwKeyCallback);
+        glfwSetWindowRefreshCallback(window, glfwRefreshCallback);
         glfwShowWindow(window);
 
         return true;
     }
 
-    static auto initializeBgfx() -> bool {
-        // Tell bgfx to not create a separate render thread
-        bgfx::renderFrame();
+    static auto initializeBgfx(const WindowOptions &options) -> bool {
+        // Calling renderFrame before init tells bgfx to not create a separate render thread
+        if (!options.threadedRender) { bgfx::renderFrame(); }
 
         glfwSetWindow(window);
 
@@ -169,6 +182,12 @@ namespace vx {
         bgfx::setDebug(BGFX_DEBUG_TEXT);
         bgfx::setViewClear(0, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x32323232, 1.0f, 0);
         bgfx::setViewRect(0, 0, 0, bgfx::BackbufferRatio::Equal);
+
+        // Chunk draws arrive already sorted by the draw list, keep bgfx from reordering them. The draw list may
+        // spread them over the views following 0, those only differ from it by not clearing.
+        for (bgfx::ViewId view = 0; view < gfx::kMaxSubmitSlices; ++view) {
+            bgfx::setViewMode(view, bgfx::ViewMode::Sequential);
+        }
         imguiCreate();
 
 #ifdef __APPLE__
@@ -185,7 +204,10 @@ namespace vx {
         return res;
     }
 
-    auto launchWindow(const std::string &windowTitle) -> int {
+    auto renderOnDemand() -> bool & { return renderOnDemandEnabled; }
+
+    auto launchWindow(const std::string &windowTitle, const WindowOptions &options) -> int {
+        renderOnDemandEnabled = options.renderOnDemand;
         camera->resize(windowDimensions.x, windowDimensions.y);
         camera->zoom(100);
 
@@ -197,14 +219,25 @@ namespace vx {
             return EXIT_FAILURE;
         }
 
-        initializeBgfx();
+        initializeBgfx(options);
 
         menubar->registerMenu(level_editor::showProjectMenu);
         menubar->registerMenu(level_editor::showChunkMenu);
         menubar->registerMenu(level_editor::showSettingsMenu);
 
         while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+            if (renderOnDemandEnabled) {
+                glfwWaitEventsTimeout(framePacer.waitSeconds());
+
+                // Input triggers frames from the callbacks, everything else is checked here
+                auto &storage = level_editor::Project::instance()->storage();
+                framePacer.observeCamera(camera->viewMatrix());
+                framePacer.observeJobs(util::ThreadPool::instance()->activeTasks());
+                if (storage->hasDirtyChunks() || widgets::isToastWidgetVisible()) { framePacer.requestFrames(); }
+                if (!framePacer.beginFrame()) { continue; }
+            } else {
+                glfwPollEvents();
+            }
 
             //==============================
             const auto currentMousePosition = input->currentMousePos();
@@ -221,11 +254,35 @@ namespace vx {
             bgfx::dbgTextClear();
             bgfx::dbgTextPrintf(0, 0, 0x6f, "");
 
-            bgfx::setViewTransform(0, &camera->viewMatrix(), &camera->projectionMatrix());
-
-            bgfx::setViewRect(0, 0, 0, windowDimensions.x, windowDimensions.y);
-
-            level_editor::Project::instance()->render();
+            for (bgfx::ViewId view = 0; view < gfx::kMaxSubmitSlices; ++view) {
+                bgfx::setViewTransform(view, &camera->viewMatrix(), &camera->projectionMatrix());
+                bgfx::setViewRect(view, 0, 0, windowDimensions.x, windowDimensions.y);
+            }
+
+            // projection[1][1] is 1 / tan(fovy / 2), scale it to pixels per unit at a distance of one
+            gfx::RenderView view;
+            view.eye = camera->eyePosition();
+            view.projectionScale = camera->projectionMatrix()[1][1] * static_cast<float>(windowDimensions.y) * 0.5f;
+            level_editor::Project::instance()->render(view);
+
+            const auto &drawStats = level_editor::Project::instance()->storage()->drawStats();
+            bgfx::dbgTextPrintf(0, 1, 0x0f, "Draws: %u, sort: %.3f ms, encoders: %u", drawStats.draws,
+                                drawStats.sortMilliseconds, drawStats.encoders);
+            const auto &poolStats = level_editor::Project::instance()->storage()->bufferPoolStats();
+            bgfx::dbgTextPrintf(0, 2, 0x0f, "Buffer pool hits: %llu, misses: %llu, free: %u",
+                                static_cast<unsigned long long>(poolStats.hits),
+                                static_cast<unsigned long long>(poolStats.misses), poolStats.free);
+            const auto &residency = level_editor::Project::instance()->storage()->residency();
+            bgfx::dbgTextPrintf(0, 3, 0x0f, "Chunk buffers: %.1f / %.1f MB",
+                                static_cast<double>(residency.residentBytes()) / (1024.0 * 1024.0),
+                                static_cast<double>(residency.budget()) / (1024.0 * 1024.0));
+            if (options.threadedRender) {
+                // Time this thread spent blocked on the render thread last frame, near zero when update dominates
+                const auto *stats = bgfx::getStats();
+                bgfx::dbgTextPrintf(0, 4, 0x0f, "Render thread, waited: %.3f ms",
+                                    static_cast<double>(stats->waitRender) * 1000.0 /
+                                            static_cast<double>(stats->cpuTimerFreq));
+            }
 
             bgfx::frame();
         }
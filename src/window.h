@@ -6,6 +6,22 @@
 #include <string>
 
 namespace vx {
+    struct WindowOptions {
+        // Let bgfx render on its own thread so editor work on this thread overlaps the previous frame's rendering.
+        // bgfx::frame() hands the recorded frame (draws, view transforms, copied uploads) over to the render thread
+        // as an immutable snapshot while the next one is recorded, so frame time becomes max(update, render).
+        bool threadedRender = false;
+
+        // Only draw frames when something changed instead of continuously, see renderOnDemand()
+        bool renderOnDemand = false;
+    };
+
     auto currentWindowSize() -> ivec2;
-    auto launchWindow(const std::string &windowTitle) -> int;
+
+    /**
+     * Whether the editor loop sleeps until input, a camera move, a chunk edit, a finished background job or an
+     * animation needs a new frame. Can be toggled at runtime.
+     */
+    auto renderOnDemand() -> bool &;
+    auto launchWindow(const std::string &windowTitle, const WindowOptions &options = {}) -> int;
 }// namespace vx
@@ -0,0 +1,79 @@
+#include "../src/util/batch_file.h"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace vx::util;
+
+static auto makeBytes(usize size, u8 seed) -> std::vector<u8> {
+    std::vector<u8> bytes(size);
+    for (usize ii = 0; ii < size; ++ii) { bytes.at(ii) = static_cast<u8>(seed + ii * 7); }
+    return bytes;
+}
+
+class BatchFileTest : public ::testing::Test {
+protected:
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "batch_file_test.bin";
+
+    void SetUp() override { std::filesystem::remove(path); }
+    void TearDown() override { std::filesystem::remove(path); }
+};
+
+TEST_F(BatchFileTest, opensOnlyExistingFilesUnlessCreating) {
+    EXPECT_FALSE(BatchFile::open(path).has_value());
+    auto file = BatchFile::open(path, true);
+    ASSERT_TRUE(file.has_value());
+    EXPECT_EQ(file->size(), 0);
+}
+
+TEST_F(BatchFileTest, readsBackABatchOfWrites) {
+    auto file = BatchFile::open(path, true);
+    ASSERT_TRUE(file.has_value());
+
+    // Out of order and sparse, with one write larger than the staging buffer of the io_uring backend
+    const auto first = makeBytes(100, 1);
+    const auto second = makeBytes(5000, 2);
+    const auto large = makeBytes(3 << 20, 3);
+    const std::vector<FileWrite> writes = {{8192, second}, {0, first}, {16384, large}};
+    ASSERT_TRUE(file->write(writes));
+    EXPECT_EQ(file->size(), 16384 + large.size());
+
+    std::vector<u8> readFirst(first.size());
+    std::vector<u8> readSecond(second.size());
+    std::vector<u8> readLarge(large.size());
+    const std::vector<FileRead> reads = {{16384, readLarge}, {0, readFirst}, {8192, readSecond}};
+    ASSERT_TRUE(file->read(reads));
+    EXPECT_EQ(readFirst, first);
+    EXPECT_EQ(readSecond, second);
+    EXPECT_EQ(readLarge, large);
+}
+
+TEST_F(BatchFileTest, handlesBatchesLargerThanTheQueue) {
+    auto file = BatchFile::open(path, true);
+    ASSERT_TRUE(file.has_value());
+
+    std::vector<std::vector<u8>> records;
+    std::vector<FileWrite> writes;
+    for (u8 ii = 0; ii < 200; ++ii) { records.push_back(makeBytes(4096, ii)); }
+    for (usize ii = 0; ii < records.size(); ++ii) { writes.push_back({ii * 4096, records.at(ii)}); }
+    ASSERT_TRUE(file->write(writes));
+
+    std::vector<std::vector<u8>> readRecords(records.size(), std::vector<u8>(4096));
+    std::vector<FileRead> reads;
+    for (usize ii = 0; ii < readRecords.size(); ++ii) { reads.push_back({ii * 4096, readRecords.at(ii)}); }
+    ASSERT_TRUE(file->read(reads));
+    EXPECT_EQ(readRecords, records);
+}
+
+TEST_F(BatchFileTest, failsReadsPastTheEnd) {
+    auto file = BatchFile::open(path, true);
+    ASSERT_TRUE(file.has_value());
+    const auto bytes = makeBytes(100, 1);
+    const std::vector<FileWrite> writes = {{0, bytes}};
+    ASSERT_TRUE(file->write(writes));
+
+    std::vector<u8> inside(50);
+    std::vector<u8> past(100);
+    const std::vector<FileRead> reads = {{0, inside}, {50, past}};
+    EXPECT_FALSE(file->read(reads));
+}
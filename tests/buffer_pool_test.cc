@@ -0,0 +1,62 @@
+#include "../src/gfx/buffer_pool.h"
+#include <gtest/gtest.h>
+
+using namespace vx::gfx;
+
+TEST(TestBufferPool, sizeClassesArePowersOfTwo) {
+    EXPECT_EQ(bufferSizeClass(0), 0);
+    EXPECT_EQ(bufferSizeClass(1u << kMinBufferSizeClass), 0);
+    EXPECT_EQ(bufferSizeClass((1u << kMinBufferSizeClass) + 1), 1);
+    EXPECT_EQ(bufferSizeClass(1u << (kMinBufferSizeClass + 3)), 3);
+}
+
+class TestBufferPoolRecycling : public ::testing::Test {
+protected:
+    void SetUp() override {
+        bgfx::renderFrame();
+        bgfx::Init init;
+        init.type = bgfx::RendererType::Noop;
+        init.resolution.width = 64;
+        init.resolution.height = 64;
+        ASSERT_TRUE(bgfx::init(init));
+    }
+
+    void TearDown() override { bgfx::shutdown(); }
+};
+
+TEST_F(TestBufferPoolRecycling, reusesBuffersAfterFrameLatency) {
+    BufferPool pool;
+    auto buffers = pool.acquire(100, 150);
+    EXPECT_EQ(pool.stats().misses, 2);
+
+    // Released buffers may still be drawn by in-flight frames, they can't be handed out yet
+    pool.release(buffers);
+    auto early = pool.acquire(100, 150);
+    EXPECT_EQ(pool.stats().misses, 4);
+
+    for (u64 frame = 0; frame < kBufferReleaseLatency; ++frame) { pool.nextFrame(); }
+    EXPECT_EQ(pool.stats().free, 2);
+
+    auto reused = pool.acquire(200, 10);
+    EXPECT_EQ(pool.stats().hits, 2);
+    EXPECT_EQ(pool.stats().misses, 4);
+
+    pool.release(early);
+    pool.release(reused);
+    pool.destroy();
+}
+
+TEST_F(TestBufferPoolRecycling, uploadGrowsBuffers) {
+    BufferPool pool;
+    auto buffers = pool.acquire(8, 8);
+    const auto capacity = buffers.vertexCapacity;
+
+    std::vector<VertexColor> vertices(capacity + 1);
+    std::vector<BlockIndexSize> indices(6, 0);
+    pool.upload(buffers, vertices, indices);
+    EXPECT_GT(buffers.vertexCapacity, capacity);
+    EXPECT_EQ(pool.stats().pending, 2);
+
+    pool.release(buffers);
+    pool.destroy();
+}
@@ -0,0 +1,236 @@
+#include "../src/gfx/chunk_file.h"
+#include "../src/util/bytes.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <limits>
+
+using namespace vx::gfx;
+
+static auto makeChunk() -> Chunk {
+    std::array<uuids::uuid::value_type, 16> identifier{};
+    for (usize ii = 0; ii < identifier.size(); ++ii) { identifier.at(ii) = static_cast<u8>(ii * 7); }
+
+    std::vector<BlockType> voxels(3 * 2 * 4, BlockType::kDirt);
+    voxels.at(5) = BlockType::kGrass;
+    return {true, BlockType::kDirt, "Bridge", "core", uuids::uuid(identifier), 3, 2, 4, -16, 0, 32, voxels, {}};
+}
+
+TEST(TestChunkFile, roundTripsMetadataAndVoxels) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_test.vxc";
+    const auto chunk = makeChunk();
+    ASSERT_TRUE(writeChunkFile(chunk, path, ChunkCodec::kNone));
+
+    auto loaded = readChunkFile(path);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->id, chunk.id);
+    EXPECT_EQ(loaded->name, chunk.name);
+    EXPECT_EQ(loaded->shaderModule, chunk.shaderModule);
+    EXPECT_EQ(loaded->isStatic, chunk.isStatic);
+    EXPECT_EQ(loaded->blockType, chunk.blockType);
+    EXPECT_EQ(loaded->dimensions(), chunk.dimensions());
+    EXPECT_EQ(loaded->translation(), chunk.translation());
+    EXPECT_EQ(loaded->voxels, chunk.voxels);
+
+    // The mesh is rebuilt from the voxels when first needed
+    EXPECT_EQ(loaded->mesh, nullptr);
+    loaded->ensureGeometry();
+    EXPECT_EQ(loaded->mesh->vertices.size(), chunk.voxels.size() * kCubeVertices.size());
+    EXPECT_EQ(std::filesystem::file_size(path), kChunkFileHeaderSize + 6 + 4 + chunk.voxels.size());
+
+    std::filesystem::remove(path);
+}
+
+TEST(TestChunkFile, rejectsTruncatedFiles) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_truncated_test.vxc";
+    ASSERT_TRUE(writeChunkFile(makeChunk(), path));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    EXPECT_FALSE(readChunkFile(path).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(TestChunkFile, editsCopyMappedVoxels) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_mapped_test.vxc";
+    ASSERT_TRUE(writeChunkFile(makeChunk(), path, ChunkCodec::kNone));
+
+    auto loaded = readChunkFile(path);
+    ASSERT_TRUE(loaded.has_value());
+    auto shared = loaded->voxels;
+    EXPECT_EQ(shared.data(), loaded->voxels.data());
+
+    // Writing copies the voxels out of the mapping, leaving other views and the file untouched
+    loaded->voxels.mutableVoxels()[0] = BlockType::kGrass;
+    EXPECT_FALSE(loaded->voxels.isMapped());
+    EXPECT_TRUE(shared.isMapped());
+    EXPECT_EQ(shared.at(0), BlockType::kDirt);
+    EXPECT_EQ(readChunkFile(path)->voxels.at(0), BlockType::kDirt);
+
+    // Replacing the file doesn't disturb the mapped voxels
+    ASSERT_TRUE(writeChunkFile(*loaded, path, ChunkCodec::kNone));
+    EXPECT_EQ(shared.at(0), BlockType::kDirt);
+    EXPECT_EQ(readChunkFile(path)->voxels.at(0), BlockType::kGrass);
+
+    std::filesystem::remove(path);
+}
+
+TEST(TestChunkFile, roundTripsEveryCodec) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_codec_test.vxc";
+    const auto chunk = makeChunk();
+    for (int codec = 0; codec < kChunkCodecs; ++codec) {
+        ASSERT_TRUE(writeChunkFile(chunk, path, static_cast<ChunkCodec>(codec)));
+
+        const auto loaded = readChunkFile(path);
+        ASSERT_TRUE(loaded.has_value()) << kAvailableChunkCodecs.at(codec);
+        EXPECT_EQ(loaded->voxels, chunk.voxels) << kAvailableChunkCodecs.at(codec);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(TestChunkFile, readsVersionOneFiles) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_v1_test.vxc";
+    const auto chunk = makeChunk();
+    ASSERT_TRUE(writeChunkFile(chunk, path, ChunkCodec::kNone));
+
+    // Version 1 files are uncompressed version 2 files with a zero codec byte
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(4);
+        file.put(1);
+    }
+
+    const auto loaded = readChunkFile(path);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->voxels, chunk.voxels);
+    std::filesystem::remove(path);
+}
+
+TEST(TestChunkFile, rejectsCorruptCompressedVoxels) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_corrupt_test.vxc";
+    ASSERT_TRUE(writeChunkFile(makeChunk(), path, ChunkCodec::kRunLengthLz));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    EXPECT_FALSE(readChunkFile(path).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(TestChunkFile, defersVoxelsUntilNeeded) {
+    const auto chunk = makeChunk();
+    const auto bytes = encodeChunk(chunk).value();
+
+    // The metadata alone is enough, the voxels are never looked at
+    const std::span<const u8> metadata(bytes.data(), chunkMetadataSize(bytes));
+    auto loaded = decodeChunkMetadata(metadata, "metadata");
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->name, chunk.name);
+    EXPECT_EQ(loaded->dimensions(), chunk.dimensions());
+    EXPECT_TRUE(loaded->voxels.empty());
+
+    int nLoads = 0;
+    loaded->voxels = VoxelStorage::deferred(chunk.voxels.size(), [&]() {
+        ++nLoads;
+        return decodeChunkVoxels(bytes, "voxels").value();
+    });
+    const auto copy = loaded->voxels;
+    EXPECT_EQ(nLoads, 0);
+
+    // Copies share the one load, and edits take their own copy of the voxels
+    EXPECT_EQ(copy, chunk.voxels);
+    loaded->voxels.mutableVoxels()[0] = BlockType::kGrass;
+    EXPECT_EQ(nLoads, 1);
+    EXPECT_EQ(copy, chunk.voxels);
+    EXPECT_EQ(loaded->voxels.at(0), BlockType::kGrass);
+}
+
+TEST(TestChunkFile, splitsVoxelsIntoBlobs) {
+    const auto chunk = makeChunk();
+    const auto blob = encodeChunkBlob(chunk, ChunkCodec::kRunLengthLz).value();
+    ASSERT_EQ(chunkBlobHash(blob.record), blob.hash);
+    EXPECT_EQ(blob.hash, vx::util::contentHash(blob.voxels));
+    EXPECT_EQ(blob.record.size(), chunkMetadataSize(blob.record));
+    EXPECT_FALSE(chunkBlobHash(encodeChunk(chunk).value()).has_value());
+
+    // The voxels can't be decoded without their blob
+    EXPECT_TRUE(decodeChunkMetadata(blob.record, "blob").has_value());
+    EXPECT_FALSE(decodeChunkVoxels(blob.record, "blob").has_value());
+
+    const auto attached = attachChunkBlob(blob.record, blob.voxels);
+    EXPECT_EQ(attached, encodeChunk(chunk, ChunkCodec::kRunLengthLz).value());
+}
+
+TEST(TestChunkFile, rejectsUnknownBlockTypes) {
+    auto bytes = encodeChunk(makeChunk(), ChunkCodec::kNone).value();
+    ASSERT_TRUE(decodeChunk(bytes, "valid").has_value());
+
+    // In the header
+    auto badHeader = bytes;
+    badHeader.at(8) = kBlockTypes;
+    EXPECT_FALSE(decodeChunk(badHeader, "header").has_value());
+
+    // And among the voxels
+    auto badVoxel = bytes;
+    badVoxel.back() = 0xff;
+    EXPECT_FALSE(decodeChunk(badVoxel, "voxels").has_value());
+    EXPECT_FALSE(decodeChunkVoxels(badVoxel, "voxels").has_value());
+}
+
+TEST(TestChunkFile, rejectsNonPositiveDimensions) {
+    // -1 x -1 x 24 would wrap to the same u64 voxel count as 1 x 1 x 24
+    auto chunk = makeChunk();
+    chunk.xdim = -1;
+    chunk.ydim = -1;
+    chunk.zdim = 24;
+    EXPECT_FALSE(decodeChunk(encodeChunk(chunk, ChunkCodec::kNone).value(), "negative").has_value());
+
+    chunk.xdim = 0;
+    EXPECT_FALSE(decodeChunk(encodeChunk(chunk, ChunkCodec::kNone).value(), "zero").has_value());
+}
+
+TEST(TestChunkFile, refusesStringsTooLongToStore) {
+    auto chunk = makeChunk();
+    chunk.name.assign(std::numeric_limits<u16>::max() + 1, 'x');
+    EXPECT_FALSE(encodeChunk(chunk).has_value());
+    EXPECT_FALSE(encodeChunkBlob(chunk).has_value());
+
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_long_name_test.vxc";
+    EXPECT_FALSE(writeChunkFile(chunk, path));
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+static void setDimensions(std::vector<u8> &bytes, i32 x, i32 y, i32 z) {
+    vx::util::putLittleEndian<i32>(bytes.data() + 28, x);
+    vx::util::putLittleEndian<i32>(bytes.data() + 32, y);
+    vx::util::putLittleEndian<i32>(bytes.data() + 36, z);
+    vx::util::putLittleEndian<u64>(bytes.data() + 56, static_cast<u64>(x) * y * z);
+}
+
+TEST(TestChunkFile, rejectsVoxelCountsThePayloadCannotHold) {
+    // 2^21 cubed is exactly 2^63 voxels, far past anything the editor can make
+    auto huge = encodeChunk(makeChunk(), ChunkCodec::kNone).value();
+    setDimensions(huge, 1 << 21, 1 << 21, 1 << 21);
+    EXPECT_FALSE(decodeChunk(huge, "huge").has_value());
+
+    // Plausible dimensions are refused before the voxels are allocated when the payload is too small for them
+    for (const auto codec : {ChunkCodec::kNone, ChunkCodec::kRunLength, ChunkCodec::kRunLengthLz}) {
+        auto bytes = encodeChunk(makeChunk(), codec).value();
+        setDimensions(bytes, 1000, 1000, 100);
+        EXPECT_FALSE(decodeChunk(bytes, "large").has_value());
+        EXPECT_FALSE(decodeChunkVoxels(bytes, "large").has_value());
+    }
+}
+
+TEST(TestChunkFile, drawsUnknownMappedVoxelsAsDebugBlocks) {
+    const auto path = std::filesystem::temp_directory_path() / "chunk_file_mapped_unknown_test.vxc";
+    auto bytes = encodeChunk(makeChunk(), ChunkCodec::kNone).value();
+    bytes.back() = 0xff;
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(bytes.data()),
+                                                static_cast<std::streamsize>(bytes.size()));
+
+    // Checking mapped voxels would page them all in, so the unknown type is only caught where it is read
+    const auto loaded = readChunkFile(path);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_TRUE(loaded->voxels.isMapped());
+    EXPECT_EQ(knownBlockType(loaded->voxels.at(loaded->voxels.size() - 1)), BlockType::kDebug);
+    EXPECT_EQ(knownBlockType(loaded->voxels.at(0)), BlockType::kDirt);
+    std::filesystem::remove(path);
+}
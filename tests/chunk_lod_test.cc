@@ -0,0 +1,80 @@
+#include "../src/gfx/chunk_lod.h"
+#include <gtest/gtest.h>
+
+using namespace vx::gfx;
+
+TEST(TestChunkLod, downsampleVoxelsPicksMajority) {
+    const ivec3 dimensions(2, 2, 2);
+    std::vector<BlockType> voxels(8, BlockType::kDirt);
+    voxels.at(0) = BlockType::kGrass;
+    voxels.at(1) = BlockType::kGrass;
+    voxels.at(2) = BlockType::kGrass;
+
+    const auto downsampled = downsampleVoxels(voxels, dimensions, 2);
+    ASSERT_EQ(downsampled.size(), 1);
+    EXPECT_EQ(downsampled.at(0), BlockType::kDirt);
+}
+
+TEST(TestChunkLod, downsampleVoxelsVotesUnknownTypesAsDebug) {
+    // Mapped voxels are not checked on load, so the LOD builder can see types it doesn't know
+    const ivec3 dimensions(2, 2, 2);
+    std::vector<BlockType> voxels(8, static_cast<BlockType>(0xff));
+    voxels.at(0) = BlockType::kGrass;
+
+    const auto downsampled = downsampleVoxels(voxels, dimensions, 2);
+    ASSERT_EQ(downsampled.size(), 1);
+    EXPECT_EQ(downsampled.at(0), BlockType::kDebug);
+}
+
+TEST(TestChunkLod, downsampleVoxelsKeepsPartialCells) {
+    const ivec3 dimensions(3, 1, 5);
+    const std::vector<BlockType> voxels(3 * 1 * 5, BlockType::kGrass);
+
+    const auto downsampled = downsampleVoxels(voxels, dimensions, 2);
+    EXPECT_EQ(downsampled.size(), 2 * 1 * 3);
+    for (const auto &blockType : downsampled) { EXPECT_EQ(blockType, BlockType::kGrass); }
+}
+
+TEST(TestChunkLod, lodMeshMatchesChunkBounds) {
+    const ivec3 dimensions(5, 4, 4);
+    const vec3 translation(10, 0, -3);
+    const std::vector<BlockType> voxels(5 * 4 * 4, BlockType::kDirt);
+
+    const auto mesh = makeLodMesh(voxels, dimensions, translation, 2);
+
+    // 2 x 1 x 1 cells
+    EXPECT_EQ(mesh.vertices.size(), 2 * kCubeVertices.size());
+    EXPECT_EQ(mesh.indices.size(), 2 * kBlockIndices.size());
+
+    vec3 maxCorner = translation;
+    for (const auto &vertex : mesh.vertices) { maxCorner = glm::max(maxCorner, vertex.position); }
+    EXPECT_EQ(maxCorner, translation + vec3(dimensions));
+}
+
+TEST(TestChunkLod, mergeChunkMeshesKeepsFaceBuckets) {
+    const std::vector<BlockType> voxels(1, BlockType::kDirt);
+    const auto first = makeLodMesh(voxels, ivec3(1), vec3(0), 0);
+    const auto second = makeLodMesh(voxels, ivec3(1), vec3(4, 0, 0), 0);
+
+    const auto merged = mergeChunkMeshes({first, second});
+    EXPECT_EQ(merged.vertices.size(), 2 * kCubeVertices.size());
+    EXPECT_EQ(merged.indices.size(), 2 * kBlockIndices.size());
+
+    // The +x bucket holds the +x face of both cubes, the second one offset past the first one's vertices
+    const auto &[start, count] = merged.faceRanges.at(FaceDirection::kPositiveX);
+    ASSERT_EQ(count, 2 * kIndicesPerFace);
+    for (u32 ii = 0; ii < kIndicesPerFace; ++ii) {
+        EXPECT_EQ(merged.indices.at(start + ii), first.indices.at(first.faceRanges.at(0).start + ii));
+        EXPECT_EQ(merged.indices.at(start + kIndicesPerFace + ii),
+                  second.indices.at(second.faceRanges.at(0).start + ii) + kCubeVertices.size());
+    }
+}
+
+TEST(TestChunkLod, selectLodLevelHasHysteresis) {
+    EXPECT_EQ(selectLodLevel(1.1f, 0), 0);
+    EXPECT_EQ(selectLodLevel(1.3f, 0), 1);
+    EXPECT_EQ(selectLodLevel(0.9f, 1), 1);
+    EXPECT_EQ(selectLodLevel(0.7f, 1), 0);
+    EXPECT_EQ(selectLodLevel(10.0f, 0), kChunkLodLevels - 1);
+    EXPECT_EQ(selectLodLevel(-4.0f, kChunkLodLevels - 1), 0);
+}
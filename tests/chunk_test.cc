@@ -0,0 +1,97 @@
+#include "../src/gfx/chunk.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <type_traits>
+
+using namespace vx::gfx;
+
+static auto makeChunk(int xtransform, std::vector<BlockType> voxels) -> Chunk {
+    return {false, BlockType::kDirt, "Pillar", "core", uuids::uuid(), 2, 3, 2, xtransform, 0, 0, std::move(voxels), {}};
+}
+
+TEST(TestChunk, copiesShareVoxelsUntilEdited) {
+    const VoxelStorage voxels(std::vector<BlockType>(8, BlockType::kDirt));
+    VoxelStorage copy = voxels;
+    EXPECT_TRUE(copy.sharesWith(voxels));
+
+    copy.mutableVoxels()[0] = BlockType::kGrass;
+    EXPECT_FALSE(copy.sharesWith(voxels));
+    EXPECT_EQ(voxels.at(0), BlockType::kDirt);
+    EXPECT_EQ(copy.at(0), BlockType::kGrass);
+}
+
+TEST(TestChunk, solidFillsAreShared) {
+    VoxelStorage first;
+    first.assign(64, BlockType::kDebug);
+    VoxelStorage second;
+    second.assign(64, BlockType::kDebug);
+    EXPECT_TRUE(second.sharesWith(first));
+
+    // Even a sole holder copies a fill before writing it, later fills stay solid
+    VoxelStorage edited;
+    edited.assign(64, BlockType::kGrass);
+    edited.mutableVoxels()[0] = BlockType::kDirt;
+    VoxelStorage fresh;
+    fresh.assign(64, BlockType::kGrass);
+    EXPECT_EQ(fresh.at(0), BlockType::kGrass);
+}
+
+TEST(TestChunk, duplicatesShareOneMesh) {
+    const auto original = makeChunk(0, std::vector<BlockType>(12, BlockType::kDirt));
+    std::vector<Chunk> duplicates;
+    for (int ii = 0; ii < 1000; ++ii) {
+        auto &duplicate = duplicates.emplace_back(original.clone());
+        duplicate.xtransform = ii * 2;
+        duplicate.ensureGeometry();
+    }
+
+    // Chunks holding equal voxels share the mesh even when their voxels were never copied from one another
+    auto separate = makeChunk(-8, std::vector<BlockType>(12, BlockType::kDirt));
+    separate.ensureGeometry();
+    for (const auto &duplicate : duplicates) {
+        EXPECT_TRUE(duplicate.voxels.sharesWith(original.voxels));
+        EXPECT_EQ(duplicate.mesh, separate.mesh);
+    }
+
+    // The mesh is in chunk space, each chunk is drawn at its own translation
+    for (const auto &[position, _color] : separate.mesh->vertices) {
+        for (int axis = 0; axis < 3; ++axis) {
+            EXPECT_GE(position[axis], 0);
+            EXPECT_LE(position[axis], separate.dimensions()[axis]);
+        }
+    }
+
+    auto &edited = duplicates.front();
+    edited.voxels.mutableVoxels()[0] = BlockType::kGrass;
+    edited.makeGeometry();
+    EXPECT_NE(edited.mesh, separate.mesh);
+    EXPECT_FALSE(edited.voxels.sharesWith(original.voxels));
+    EXPECT_EQ(duplicates.back().mesh, separate.mesh);
+    EXPECT_EQ(original.voxels.at(0), BlockType::kDirt);
+}
+
+TEST(TestChunk, movesWithoutCopying) {
+    static_assert(!std::is_copy_constructible_v<Chunk> && !std::is_copy_assignable_v<Chunk>);
+    static_assert(std::is_nothrow_move_constructible_v<Chunk> && std::is_nothrow_move_assignable_v<Chunk>);
+
+    auto chunk = makeChunk(4, std::vector<BlockType>(12, BlockType::kGrass));
+    chunk.ensureGeometry();
+    const auto *voxels = chunk.voxels.data();
+    const auto *mesh = chunk.mesh.get();
+
+    // Each holder of the voxels or the mesh is a copy of it, moving along the way chunks are loaded and stored
+    // adds none
+    std::optional<Chunk> loaded(std::move(chunk));
+    std::vector<Chunk> stored;
+    stored.push_back(std::move(loaded.value()));
+    stored.reserve(stored.capacity() + 1);
+    const auto &moved = stored.front();
+    EXPECT_EQ(moved.voxels.data(), voxels);
+    EXPECT_EQ(moved.mesh.get(), mesh);
+    EXPECT_EQ(moved.mesh.use_count(), 1);
+
+    // Asked-for copies share both until edited
+    const auto copy = moved.clone();
+    EXPECT_TRUE(copy.voxels.sharesWith(moved.voxels));
+    EXPECT_EQ(moved.mesh.use_count(), 2);
+}
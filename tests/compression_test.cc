@@ -0,0 +1,90 @@
+#include "../src/util/compression.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace vx::util;
+
+static auto makeVoxelLikeBytes(usize size) -> std::vector<u8> {
+    // Long runs of a few values, like the voxels of a chunk
+    std::mt19937 generator(7);
+    std::vector<u8> bytes;
+    while (bytes.size() < size) {
+        const auto run = std::min<usize>(generator() % 300 + 1, size - bytes.size());
+        bytes.insert(bytes.end(), run, static_cast<u8>(generator() % 4));
+    }
+    return bytes;
+}
+
+static auto makeRandomBytes(usize size) -> std::vector<u8> {
+    std::mt19937 generator(11);
+    std::vector<u8> bytes(size);
+    for (auto &byte : bytes) { byte = static_cast<u8>(generator()); }
+    return bytes;
+}
+
+TEST(TestCompression, runLengthRoundTrips) {
+    const auto bytes = makeVoxelLikeBytes(100000);
+    const auto encoded = runLengthEncode(bytes);
+    EXPECT_LT(encoded.size(), bytes.size() / 50);
+
+    std::vector<u8> decoded(bytes.size());
+    ASSERT_TRUE(runLengthDecode(encoded, decoded));
+    EXPECT_EQ(decoded, bytes);
+}
+
+TEST(TestCompression, runLengthRejectsWrongSize) {
+    const std::vector<u8> bytes(1000, 3);
+    const auto encoded = runLengthEncode(bytes);
+
+    std::vector<u8> tooSmall(999);
+    std::vector<u8> tooLarge(1001);
+    EXPECT_FALSE(runLengthDecode(encoded, tooSmall));
+    EXPECT_FALSE(runLengthDecode(encoded, tooLarge));
+}
+
+TEST(TestCompression, lzRoundTrips) {
+    for (const auto &bytes : {makeVoxelLikeBytes(200000), makeRandomBytes(50000), std::vector<u8>(70000, 9),
+                              std::vector<u8>{}, std::vector<u8>{1, 2, 3}}) {
+        const auto compressed = lzCompress(bytes);
+
+        std::vector<u8> decompressed(bytes.size());
+        ASSERT_TRUE(lzDecompress(compressed, decompressed));
+        EXPECT_EQ(decompressed, bytes);
+    }
+}
+
+TEST(TestCompression, lzCompressesRepeats) {
+    const std::vector<u8> bytes(70000, 9);
+    EXPECT_LT(lzCompress(bytes).size(), 400);
+}
+
+TEST(TestCompression, lzRejectsCorruptBlocks) {
+    const auto bytes = makeVoxelLikeBytes(10000);
+    auto compressed = lzCompress(runLengthEncode(bytes));
+    std::vector<u8> output(runLengthEncode(bytes).size());
+
+    auto truncated = compressed;
+    truncated.pop_back();
+    EXPECT_FALSE(lzDecompress(truncated, output));
+
+    // An offset reaching back before the start of the output
+    const std::vector<u8> badOffset = {0x00, 0xff, 0xff, 0x00};
+    EXPECT_FALSE(lzDecompress(badOffset, output));
+}
+
+TEST(TestCompression, runLengthDecodedSizeSumsRuns) {
+    const auto bytes = makeVoxelLikeBytes(100000);
+    EXPECT_EQ(runLengthDecodedSize(runLengthEncode(bytes)), bytes.size());
+    EXPECT_EQ(runLengthDecodedSize({}), 0u);
+
+    // A run whose varint is cut off, and two runs adding up past u64
+    const std::vector<u8> truncated = {0x01, 0x80};
+    EXPECT_FALSE(runLengthDecodedSize(truncated).has_value());
+    std::vector<u8> overflowing;
+    for (int ii = 0; ii < 2; ++ii) {
+        overflowing.push_back(0x01);
+        overflowing.insert(overflowing.end(), 9, 0xff);
+        overflowing.push_back(0x01);
+    }
+    EXPECT_FALSE(runLengthDecodedSize(overflowing).has_value());
+}
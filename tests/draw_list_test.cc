@@ -0,0 +1,128 @@
+#include "../src/gfx/draw_list.h"
+#include "../src/util/timer.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace vx::gfx;
+
+TEST(TestDrawList, radixSortOrdersKeys) {
+    std::mt19937_64 generator(42);
+    std::vector<SortEntry> entries;
+    for (u32 ii = 0; ii < 1000; ++ii) { entries.push_back({generator(), ii}); }
+
+    std::vector<SortEntry> scratch;
+    radixSort(entries, scratch);
+    EXPECT_TRUE(std::is_sorted(entries.begin(), entries.end(),
+                               [](const auto &lhs, const auto &rhs) { return lhs.key < rhs.key; }));
+}
+
+TEST(TestDrawList, radixSortIsStable) {
+    std::vector<SortEntry> entries;
+    for (u32 ii = 0; ii < 64; ++ii) { entries.push_back({static_cast<u64>(ii % 4) << 40, ii}); }
+
+    std::vector<SortEntry> scratch;
+    radixSort(entries, scratch);
+    for (usize ii = 1; ii < entries.size(); ++ii) {
+        if (entries.at(ii).key == entries.at(ii - 1).key) {
+            EXPECT_LT(entries.at(ii - 1).index, entries.at(ii).index);
+        }
+    }
+}
+
+TEST(TestDrawList, sortKeyGroupsByProgramThenDepth) {
+    const bgfx::DynamicVertexBufferHandle nearBuffer{7};
+    const bgfx::DynamicVertexBufferHandle farBuffer{2};
+
+    // Nearer draws go first within a program, even with a larger buffer handle
+    EXPECT_LT(makeSortKey(0, {1}, 1.5f, nearBuffer), makeSortKey(0, {1}, 100.0f, farBuffer));
+
+    // The program outranks depth
+    EXPECT_LT(makeSortKey(0, {1}, 1000.0f, farBuffer), makeSortKey(0, {2}, 0.0f, nearBuffer));
+
+    // And the view outranks everything
+    EXPECT_LT(makeSortKey(0, {5}, 1000.0f, farBuffer), makeSortKey(1, {0}, 0.0f, nearBuffer));
+}
+
+TEST(TestDrawList, sortOrdersDrawsFrontToBack) {
+    DrawList drawList;
+    for (const float depth : {30.0f, 10.0f, 20.0f}) {
+        DrawCall drawCall;
+        drawCall.sortKey = makeSortKey(0, {0}, depth, {0});
+        drawList.push(drawCall);
+    }
+    drawList.sort();
+
+    ASSERT_EQ(drawList.stats().draws, 3);
+    const auto &order = drawList.order();
+    EXPECT_EQ(order.at(0).index, 1);
+    EXPECT_EQ(order.at(1).index, 2);
+    EXPECT_EQ(order.at(2).index, 0);
+}
+
+class TestDrawListSubmission : public ::testing::Test {
+protected:
+    static constexpr u32 kDraws = 4096;
+
+    bgfx::DynamicVertexBufferHandle vertexBuffer_ = BGFX_INVALID_HANDLE;
+    bgfx::DynamicIndexBufferHandle indexBuffer_ = BGFX_INVALID_HANDLE;
+
+    void SetUp() override {
+        // Render on this thread, the Noop renderer needs no window
+        bgfx::renderFrame();
+        bgfx::Init init;
+        init.type = bgfx::RendererType::Noop;
+        init.resolution.width = 64;
+        init.resolution.height = 64;
+        ASSERT_TRUE(bgfx::init(init));
+
+        bgfx::VertexLayout vertexLayout;
+        vertexLayout.begin().add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float).end();
+        vertexBuffer_ = bgfx::createDynamicVertexBuffer(3, vertexLayout);
+        indexBuffer_ = bgfx::createDynamicIndexBuffer(3, BGFX_BUFFER_INDEX32);
+    }
+
+    void TearDown() override {
+        bgfx::destroy(vertexBuffer_);
+        bgfx::destroy(indexBuffer_);
+        bgfx::shutdown();
+    }
+
+    void fill(DrawList &drawList) const {
+        for (u32 ii = 0; ii < kDraws; ++ii) {
+            DrawCall drawCall;
+            drawCall.sortKey = makeSortKey(0, BGFX_INVALID_HANDLE, static_cast<float>(kDraws - ii), vertexBuffer_);
+            drawCall.vertexBuffer = vertexBuffer_;
+            drawCall.indexBuffer = indexBuffer_;
+            drawCall.indexCount = 3;
+            drawList.push(drawCall);
+        }
+        drawList.sort();
+    }
+};
+
+TEST_F(TestDrawListSubmission, submitsEveryDrawOnOneThread) {
+    DrawList drawList;
+    fill(drawList);
+    drawList.submit();
+    bgfx::frame();
+
+    EXPECT_EQ(drawList.stats().encoders, 1);
+    EXPECT_EQ(bgfx::getStats()->numDraw, kDraws);
+}
+
+TEST_F(TestDrawListSubmission, submitsEveryDrawAcrossEncoders) {
+    vx::util::ThreadPool pool(kMaxSubmitSlices - 1);
+    DrawList drawList;
+    fill(drawList);
+
+    vx::util::Timer timer;
+    timer.start();
+    drawList.submit(&pool);
+    const auto elapsed = timer.elapsed();
+    bgfx::frame();
+
+    spdlog::info("Recorded {} draws on {} encoders in {:.3f} ms", kDraws, drawList.stats().encoders, elapsed * 1000.0);
+    EXPECT_GT(drawList.stats().encoders, 1);
+    EXPECT_EQ(bgfx::getStats()->numDraw, kDraws);
+}
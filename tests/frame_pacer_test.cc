@@ -0,0 +1,32 @@
+#include "../src/gfx/frame_pacer.h"
+#include <gtest/gtest.h>
+
+using namespace vx::gfx;
+
+TEST(TestFramePacer, settlesIntoIdle) {
+    FramePacer framePacer;
+    for (u32 frame = 0; frame < kActivityFrames; ++frame) {
+        EXPECT_EQ(framePacer.waitSeconds(), 0);
+        EXPECT_TRUE(framePacer.beginFrame());
+    }
+
+    EXPECT_FALSE(framePacer.beginFrame());
+    EXPECT_EQ(framePacer.waitSeconds(), kIdleWaitSeconds);
+}
+
+TEST(TestFramePacer, wakesForFinishedJobs) {
+    FramePacer framePacer;
+    while (framePacer.beginFrame()) {}
+
+    framePacer.observeJobs(2);
+    EXPECT_TRUE(framePacer.beginFrame());
+    while (framePacer.beginFrame()) {}
+
+    // Jobs still running keep the wait short so their results are picked up quickly
+    EXPECT_EQ(framePacer.waitSeconds(), kBusyWaitSeconds);
+    framePacer.observeJobs(2);
+    EXPECT_FALSE(framePacer.beginFrame());
+
+    framePacer.observeJobs(0);
+    EXPECT_TRUE(framePacer.beginFrame());
+}
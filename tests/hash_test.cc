@@ -0,0 +1,26 @@
+#include "../src/util/hash.h"
+#include <gtest/gtest.h>
+#include <string_view>
+
+using namespace vx::util;
+
+static auto bytesOf(std::string_view text) -> std::span<const u8> {
+    return {reinterpret_cast<const u8 *>(text.data()), text.size()};
+}
+
+TEST(TestHash, matchesReferenceXxHash64) {
+    EXPECT_EQ(xxHash64({}), 0xef46db3751d8e999ull);
+    EXPECT_EQ(xxHash64(bytesOf("abc")), 0x44bc2cf5ad770999ull);
+    EXPECT_EQ(xxHash64(bytesOf("Nobody inspects the spammish repetition")), 0xfbcea83c8a378bf1ull);
+}
+
+TEST(TestHash, contentHashesDifferOnAnyByte) {
+    std::vector<u8> bytes(4096, 7);
+    const auto hash = contentHash(bytes);
+    EXPECT_EQ(contentHash(bytes), hash);
+    EXPECT_NE(hash.low, hash.high);
+
+    bytes.at(2048) = 8;
+    EXPECT_NE(contentHash(bytes), hash);
+    EXPECT_EQ(hash.toString().size(), 32);
+}
@@ -0,0 +1,118 @@
+#include "../src/gfx/legacy_chunk.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace vx::gfx;
+
+// A 1x1x2 chunk laid out the way the XML chunk writer did
+static auto makeLegacyXml(bool emptyLists) -> std::string {
+    std::string xml = R"(<?xml version="1.0"?>
+<project name="Level" version="0.1.0">
+	<component name="id" value="0f0e0d0c-0b0a-0908-0706-050403020100" />
+	<component name="name" value="Tom &amp; Jerry" />
+	<component name="shaderModule" value="core" />
+	<component name="isStatic" value="true" />
+	<component name="dimensions">
+		<map>
+			<entry key="xdim" value="1" />
+			<entry key="ydim" value="1" />
+			<entry key="zdim" value="2" />
+		</map>
+	</component>
+	<component name="transform">
+		<map>
+			<entry key="xtransform" value="-16" />
+			<entry key="ytransform" value="0" />
+			<entry key="ztransform" value="32" />
+		</map>
+	</component>
+	<component name="indices">
+		<property name="nNodes" value="72" />
+)";
+    xml += emptyLists ? "\t\t<indices-list />\n"
+                      : "\t\t<indices-list>\n\t\t\t<item index=\"0\" />\n\t\t</indices-list>\n";
+    xml += R"(	</component>
+	<component name="vertices">
+		<property name="nNodes" value="16" />
+		<property name="blockType" value="grass" />
+		<property name="vertexType" value="VertexColor" />
+)";
+    xml += emptyLists ? "\t\t<vertices-list />\n"
+                      : "\t\t<vertices-list>\n\t\t\t<item index=\"0\" xpos=\"0\" ypos=\"0\" zpos=\"0\" />\n"
+                        "\t\t</vertices-list>\n";
+    xml += "\t</component>\n</project>\n";
+    return xml;
+}
+
+TEST(TestLegacyChunk, stripsTheIndexAndVertexLists) {
+    for (const bool emptyLists : {false, true}) {
+        const auto stripped = stripLegacyChunkLists(makeLegacyXml(emptyLists));
+        ASSERT_TRUE(stripped.has_value());
+        EXPECT_EQ(stripped->find("item"), std::string::npos);
+        EXPECT_EQ(stripped->find("-list"), std::string::npos);
+        EXPECT_NE(stripped->find(R"(<property name="blockType" value="grass" />)"), std::string::npos);
+    }
+
+    EXPECT_FALSE(stripLegacyChunkLists("<project></project>").has_value());
+}
+
+TEST(TestLegacyChunk, readsMetadataAndFillsVoxels) {
+    const auto path = std::filesystem::temp_directory_path() / "legacy_chunk_test.xml";
+    std::ofstream(path) << makeLegacyXml(false);
+
+    const auto chunk = readLegacyChunkFile(path);
+    std::filesystem::remove(path);
+    ASSERT_TRUE(chunk.has_value());
+    EXPECT_EQ(uuids::to_string(chunk->id), "0f0e0d0c-0b0a-0908-0706-050403020100");
+    EXPECT_EQ(chunk->name, "Tom & Jerry");
+    EXPECT_EQ(chunk->shaderModule, "core");
+    EXPECT_TRUE(chunk->isStatic);
+    EXPECT_EQ(chunk->dimensions(), ivec3(1, 1, 2));
+    EXPECT_EQ(chunk->translation(), vec3(-16, 0, 32));
+    EXPECT_EQ(chunk->blockType, BlockType::kGrass);
+    EXPECT_EQ(chunk->voxels, VoxelStorage(std::vector<BlockType>(2, BlockType::kGrass)));
+    EXPECT_EQ(chunk->mesh, nullptr);
+}
+
+TEST(TestLegacyChunk, readsWhatItEncodes) {
+    const auto identifier = uuids::uuid::from_string("0f0e0d0c-0b0a-0908-0706-050403020100").value();
+    const Chunk chunk(false, BlockType::kDirt, "Hill", "debug", identifier, 2, 1, 3, 16, 0, -32,
+                      std::vector<BlockType>(6, BlockType::kDirt), {});
+
+    const auto xml = encodeLegacyChunk(chunk, "Level");
+    EXPECT_EQ(chunk.mesh, nullptr);
+    EXPECT_NE(xml.find(R"(<property name="nNodes" value="216" />)"), std::string::npos);
+    EXPECT_NE(xml.find(R"(<property name="nNodes" value="48" />)"), std::string::npos);
+
+    const auto path = std::filesystem::temp_directory_path() / "legacy_chunk_round_trip_test.xml";
+    std::ofstream(path) << xml;
+    const auto decoded = readLegacyChunkFile(path);
+    std::filesystem::remove(path);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->id, chunk.id);
+    EXPECT_EQ(decoded->name, chunk.name);
+    EXPECT_EQ(decoded->shaderModule, chunk.shaderModule);
+    EXPECT_FALSE(decoded->isStatic);
+    EXPECT_EQ(decoded->dimensions(), chunk.dimensions());
+    EXPECT_EQ(decoded->translation(), chunk.translation());
+    EXPECT_EQ(decoded->voxels, chunk.voxels);
+}
+
+TEST(TestLegacyChunk, rejectsMalformedDimensionsAndBlockTypes) {
+    const auto path = std::filesystem::temp_directory_path() / "legacy_chunk_malformed_test.xml";
+    for (const auto &[from, to] : std::initializer_list<std::pair<std::string, std::string>>{
+                 {R"(key="xdim" value="1")", R"(key="xdim" value="-1")"},
+                 {R"(key="xdim" value="1")", R"(key="xdim" value="0")"},
+                 {R"(key="ydim" value="1")", R"(key="ydim" value="one")"},
+                 {R"(key="zdim" value="2")", R"(key="zdim" value="2147483647")"},
+                 {R"(key="xtransform" value="-16")", R"(key="xtransform" value="-16.5")"},
+                 {R"(value="grass")", R"(value="granite")"},
+         }) {
+        auto xml = makeLegacyXml(false);
+        xml.replace(xml.find(from), from.size(), to);
+        std::ofstream(path) << xml;
+        EXPECT_FALSE(readLegacyChunkFile(path).has_value()) << to;
+    }
+    std::filesystem::remove(path);
+}
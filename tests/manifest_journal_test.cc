@@ -0,0 +1,44 @@
+#include "../src/level_editor/manifest_journal.h"
+#include <gtest/gtest.h>
+
+using namespace vx::level_editor;
+
+static auto makeRecords() -> std::vector<ManifestRecord> {
+    return {{1, ManifestRecordType::kAddRegion, "r.0.0.vxr"},
+            {2, ManifestRecordType::kSetChunkCodec, "rle"},
+            {3, ManifestRecordType::kRemoveRegion, "r.0.0.vxr"}};
+}
+
+static auto encodeJournal(const std::vector<ManifestRecord> &records) -> std::vector<u8> {
+    std::vector<u8> bytes;
+    for (const auto &record : records) {
+        const auto encoded = encodeManifestRecord(record);
+        bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+    }
+    return bytes;
+}
+
+TEST(TestManifestJournal, roundTripsRecords) {
+    const auto records = makeRecords();
+    const auto journal = decodeManifestJournal(encodeJournal(records));
+    EXPECT_FALSE(journal.truncated);
+    EXPECT_EQ(journal.records, records);
+}
+
+TEST(TestManifestJournal, stopsAtATornRecord) {
+    const auto records = makeRecords();
+    auto bytes = encodeJournal(records);
+
+    // A crash part way through appending the last record
+    bytes.resize(bytes.size() - 3);
+    auto journal = decodeManifestJournal(bytes);
+    EXPECT_TRUE(journal.truncated);
+    EXPECT_EQ(journal.records, std::vector<ManifestRecord>(records.begin(), records.begin() + 2));
+
+    // Garbage in the middle ends the replay there too
+    bytes = encodeJournal(records);
+    bytes.at(kManifestRecordHeaderSize + 2) ^= 0xff;
+    journal = decodeManifestJournal(bytes);
+    EXPECT_TRUE(journal.truncated);
+    EXPECT_TRUE(journal.records.empty());
+}
@@ -0,0 +1,214 @@
+#include "../src/gfx/region_file.h"
+#include "../src/util/bytes.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace vx::gfx;
+
+static auto makeId(u32 seed) -> uuids::uuid {
+    std::array<uuids::uuid::value_type, 16> identifier{};
+    for (usize ii = 0; ii < 4; ++ii) { identifier.at(ii) = static_cast<u8>(seed >> (8 * ii)); }
+    identifier.at(15) = 1;
+    return uuids::uuid(identifier);
+}
+
+static auto makeBytes(usize size, u8 value) -> std::vector<u8> { return std::vector<u8>(size, value); }
+
+static void patchU32(const std::filesystem::path &path, u64 offset, u32 value) {
+    std::array<u8, 4> bytes{};
+    vx::util::putLittleEndian(bytes.data(), value);
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+static auto readFile(const std::filesystem::path &path) -> std::vector<u8> {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// Where the slot of a chunk starts in the file, zero if there is none
+static auto slotOffsetOf(const std::filesystem::path &path, const uuids::uuid &id) -> u64 {
+    const auto bytes = readFile(path);
+    for (u64 offset = kRegionSectorSize; offset + kRegionSlotSize <= bytes.size(); offset += kRegionSlotSize) {
+        std::array<uuids::uuid::value_type, 16> identifier{};
+        std::copy_n(bytes.begin() + static_cast<std::ptrdiff_t>(offset), 16, identifier.begin());
+        if (uuids::uuid(identifier) == id) { return offset; }
+    }
+    return 0;
+}
+
+class RegionFileTest : public ::testing::Test {
+protected:
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "region_file_test.vxr";
+
+    void SetUp() override { std::filesystem::remove(path); }
+    void TearDown() override { std::filesystem::remove(path); }
+};
+
+TEST(TestRegionCoordinates, floorsNegativeTranslations) {
+    EXPECT_EQ(regionCoordinates(vec3(0, 100, kRegionSpan - 1)), ivec2(0, 0));
+    EXPECT_EQ(regionCoordinates(vec3(-1, 0, kRegionSpan)), ivec2(-1, 1));
+    EXPECT_EQ(regionFileName(ivec2(-1, 1)), "r.-1.1.vxr");
+}
+
+TEST_F(RegionFileTest, storesChunksAcrossReopens) {
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region.has_value());
+        ASSERT_TRUE(region->write(makeId(1), makeBytes(100, 1)));
+        ASSERT_TRUE(region->write(makeId(2), makeBytes(10000, 2)));
+    }
+
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region.has_value());
+    EXPECT_EQ(region->size(), 2);
+    EXPECT_EQ(region->read(makeId(1)), makeBytes(100, 1));
+    EXPECT_EQ(region->read(makeId(2)), makeBytes(10000, 2));
+    EXPECT_FALSE(region->read(makeId(3)).has_value());
+}
+
+TEST_F(RegionFileTest, rewritesInPlace) {
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region->write(makeId(1), makeBytes(5000, 1)));
+    ASSERT_TRUE(region->write(makeId(2), makeBytes(5000, 2)));
+    const auto sectors = region->sectors();
+    const auto fileSize = std::filesystem::file_size(path);
+
+    // Still fits in its two sectors
+    ASSERT_TRUE(region->write(makeId(1), makeBytes(8000, 3)));
+    EXPECT_EQ(region->sectors(), sectors);
+    EXPECT_EQ(std::filesystem::file_size(path), fileSize);
+    EXPECT_EQ(region->read(makeId(1)), makeBytes(8000, 3));
+    EXPECT_EQ(region->read(makeId(2)), makeBytes(5000, 2));
+}
+
+TEST_F(RegionFileTest, reusesErasedSectors) {
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region->write(makeId(1), makeBytes(5000, 1)));
+    ASSERT_TRUE(region->write(makeId(2), makeBytes(5000, 2)));
+    const auto sectors = region->sectors();
+
+    ASSERT_TRUE(region->erase(makeId(1)));
+    EXPECT_FALSE(region->contains(makeId(1)));
+    ASSERT_TRUE(region->write(makeId(3), makeBytes(6000, 3)));
+    EXPECT_EQ(region->sectors(), sectors);
+
+    // Outgrowing its sectors moves a chunk to the end
+    ASSERT_TRUE(region->write(makeId(3), makeBytes(9000, 4)));
+    EXPECT_GT(region->sectors(), sectors);
+    EXPECT_EQ(region->read(makeId(3)), makeBytes(9000, 4));
+    EXPECT_EQ(region->read(makeId(2)), makeBytes(5000, 2));
+}
+
+TEST_F(RegionFileTest, growsTheSlotTable) {
+    {
+        auto region = RegionFile::open(path);
+        for (u32 ii = 0; ii < kRegionInitialSlots + 10; ++ii) {
+            ASSERT_TRUE(region->write(makeId(ii), makeBytes(10 + ii % 7, static_cast<u8>(ii))));
+        }
+    }
+
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region.has_value());
+    EXPECT_EQ(region->size(), kRegionInitialSlots + 10);
+    for (u32 ii = 0; ii < kRegionInitialSlots + 10; ++ii) {
+        EXPECT_EQ(region->read(makeId(ii)), makeBytes(10 + ii % 7, static_cast<u8>(ii)));
+    }
+}
+
+TEST_F(RegionFileTest, writesAndReadsBatches) {
+    std::vector<std::vector<u8>> payloads;
+    std::vector<RegionWrite> writes;
+    for (u32 ii = 0; ii < kRegionInitialSlots + 5; ++ii) {
+        payloads.push_back(makeBytes(100 + ii, static_cast<u8>(ii)));
+    }
+    for (u32 ii = 0; ii < payloads.size(); ++ii) { writes.push_back({makeId(ii), payloads.at(ii)}); }
+
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region->write(writes));
+    }
+
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region.has_value());
+    const auto ids = region->chunkIds();
+    const auto chunks = region->readAll();
+    ASSERT_TRUE(chunks.has_value());
+    ASSERT_EQ(chunks->size(), payloads.size());
+    for (usize ii = 0; ii < ids.size(); ++ii) { EXPECT_EQ(chunks->at(ii), region->read(ids.at(ii))); }
+    EXPECT_EQ(region->read(makeId(7)), payloads.at(7));
+}
+
+TEST_F(RegionFileTest, rejectsCorruptSlotCounts) {
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region->write(makeId(1), makeBytes(100, 1)));
+    }
+
+    patchU32(path, 8, 0xffffffff);
+    EXPECT_FALSE(RegionFile::open(path).has_value());
+}
+
+TEST_F(RegionFileTest, dropsSlotsPastTheEndOfTheFile) {
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region->write(makeId(1), makeBytes(100, 1)));
+        ASSERT_TRUE(region->write(makeId(2), makeBytes(100, 2)));
+    }
+
+    // Point the first chunk's slot at a sector where first sector + length wraps a u32
+    const u64 slotOffset = slotOffsetOf(path, makeId(1));
+    ASSERT_NE(slotOffset, 0);
+    patchU32(path, slotOffset + 16, 0xffffffff);
+
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region.has_value());
+    EXPECT_FALSE(region->contains(makeId(1)));
+    EXPECT_EQ(region->read(makeId(2)), makeBytes(100, 2));
+}
+
+TEST_F(RegionFileTest, growsAnEmptySlotTable) {
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region->write(makeId(1), makeBytes(100, 1)));
+    }
+
+    // A table of zero slots used to double to zero forever on the first write
+    patchU32(path, 8, 0);
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region.has_value());
+        EXPECT_EQ(region->size(), 0);
+        ASSERT_TRUE(region->write(makeId(2), makeBytes(5000, 2)));
+    }
+
+    auto region = RegionFile::open(path);
+    ASSERT_TRUE(region.has_value());
+    EXPECT_EQ(region->read(makeId(2)), makeBytes(5000, 2));
+}
+
+TEST_F(RegionFileTest, rejectsSlotsClaimingTheSameChunkOrSectors) {
+    {
+        auto region = RegionFile::open(path);
+        ASSERT_TRUE(region->write(makeId(1), makeBytes(100, 1)));
+        ASSERT_TRUE(region->write(makeId(2), makeBytes(100, 2)));
+    }
+    const u64 firstSlot = slotOffsetOf(path, makeId(1));
+    const u64 secondSlot = slotOffsetOf(path, makeId(2));
+    ASSERT_NE(firstSlot, 0);
+    ASSERT_NE(secondSlot, 0);
+    const auto original = readFile(path);
+
+    // Both slots pointing at the second chunk's sector
+    const u32 secondSector = vx::util::getLittleEndian<u32>(original.data() + secondSlot + 16);
+    patchU32(path, firstSlot + 16, secondSector);
+    EXPECT_FALSE(RegionFile::open(path).has_value());
+
+    // Both slots holding the first chunk, ids only differ in their first four bytes
+    std::filesystem::remove(path);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(original.data()), original.size());
+    patchU32(path, secondSlot, 1);
+    EXPECT_FALSE(RegionFile::open(path).has_value());
+}
@@ -0,0 +1,49 @@
+#include "../src/gfx/residency.h"
+#include <gtest/gtest.h>
+
+using namespace vx::gfx;
+
+static auto chunkKey(int n) -> ResidencyKey { return ResidencyKey::chunk({static_cast<u32>(n), 0}); }
+
+TEST(TestResidency, evictsLeastRecentlyDrawnFirst) {
+    ResidencyManager residency(250);
+    for (int frame = 0; frame < 3; ++frame) {
+        residency.touch(chunkKey(frame), 100);
+        residency.nextFrame();
+    }
+    residency.touch(chunkKey(2), 100);
+
+    const auto evicted = residency.evict();
+    ASSERT_EQ(evicted.size(), 1);
+    EXPECT_EQ(evicted.at(0), chunkKey(0));
+    EXPECT_EQ(residency.residentBytes(), 200);
+}
+
+TEST(TestResidency, keepsChunksDrawnThisFrame) {
+    ResidencyManager residency(50);
+    residency.touch(chunkKey(0), 100);
+    residency.touch(chunkKey(1), 100);
+
+    EXPECT_TRUE(residency.evict().empty());
+    EXPECT_EQ(residency.residentBytes(), 200);
+
+    residency.nextFrame();
+    EXPECT_EQ(residency.evict().size(), 2);
+    EXPECT_EQ(residency.residentBytes(), 0);
+}
+
+TEST(TestResidency, evictsClusterProxiesAlongsideChunks) {
+    ResidencyManager residency(150);
+    const auto proxy = ResidencyKey::cluster(0);
+    residency.touch(proxy, 100);
+    residency.nextFrame();
+    residency.touch(chunkKey(0), 100);
+
+    // A chunk and a cluster with the same id are different holders
+    EXPECT_NE(proxy, chunkKey(0));
+
+    const auto evicted = residency.evict();
+    ASSERT_EQ(evicted.size(), 1);
+    EXPECT_EQ(evicted.at(0), proxy);
+    EXPECT_EQ(evicted.at(0).kind, ResidencyKey::Kind::kCluster);
+}
@@ -0,0 +1,175 @@
+#include "../src/level_editor/save_queue.h"
+#include <filesystem>
+#include <gtest/gtest.h>
+
+using namespace vx;
+using namespace vx::level_editor;
+
+static auto makeChunk(u8 seed, int xtransform) -> gfx::Chunk {
+    std::array<uuids::uuid::value_type, 16> identifier{};
+    identifier.at(0) = seed;
+    const std::vector<gfx::BlockType> voxels(2 * 2 * 2, gfx::BlockType::kGrass);
+    return {false, gfx::BlockType::kGrass, "Chunk", "core", uuids::uuid(identifier), 2, 2, 2, xtransform, 0, 0,
+            voxels, {}};
+}
+
+static auto loadRegion(SaveQueue &saveQueue, const std::string &fileName) -> std::optional<std::vector<gfx::Chunk>> {
+    const auto records = saveQueue.readRegion(fileName);
+    if (!records.has_value()) { return std::nullopt; }
+
+    std::vector<gfx::Chunk> chunks;
+    for (const auto &bytes : records.value()) { chunks.push_back(gfx::decodeChunk(bytes, fileName).value()); }
+    return chunks;
+}
+
+class SaveQueueTest : public ::testing::Test {
+protected:
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / "save_queue_test";
+
+    void SetUp() override {
+        std::filesystem::remove_all(folder);
+        std::filesystem::create_directory(folder);
+    }
+    void TearDown() override { std::filesystem::remove_all(folder); }
+};
+
+TEST_F(SaveQueueTest, coalescesRepeatedSaves) {
+    SaveQueue saveQueue(folder, folder / "project.xml");
+
+    auto chunk = makeChunk(1, 0);
+    saveQueue.saveChunk(chunk, gfx::ChunkCodec::kRunLengthLz);
+    chunk.name = "Renamed";
+    saveQueue.saveChunk(chunk, gfx::ChunkCodec::kRunLengthLz);
+    saveQueue.saveProjectFile("<project/>");
+    EXPECT_EQ(saveQueue.pending(), 2);
+
+    // Nothing is written until the queue is flushed
+    EXPECT_FALSE(std::filesystem::exists(folder / "r.0.0.vxr"));
+    saveQueue.flush();
+    EXPECT_EQ(saveQueue.pending(), 0);
+    EXPECT_TRUE(std::filesystem::exists(folder / "project.xml"));
+
+    const auto chunks = loadRegion(saveQueue, "r.0.0.vxr");
+    ASSERT_TRUE(chunks.has_value());
+    ASSERT_EQ(chunks->size(), 1);
+    EXPECT_EQ(chunks->front().name, "Renamed");
+}
+
+TEST_F(SaveQueueTest, movesChunksBetweenRegions) {
+    SaveQueue saveQueue(folder, folder / "project.xml");
+    saveQueue.saveChunk(makeChunk(1, 0), gfx::ChunkCodec::kNone);
+    saveQueue.saveChunk(makeChunk(2, 0), gfx::ChunkCodec::kNone);
+    saveQueue.flush();
+
+    saveQueue.saveChunk(makeChunk(1, gfx::kRegionSpan), gfx::ChunkCodec::kNone);
+    saveQueue.deleteChunk(makeChunk(2, 0).id);
+    saveQueue.flush();
+
+    // The first region was left empty and removed
+    EXPECT_FALSE(std::filesystem::exists(folder / "r.0.0.vxr"));
+    const auto chunks = loadRegion(saveQueue, "r.1.0.vxr");
+    ASSERT_TRUE(chunks.has_value());
+    EXPECT_EQ(chunks->size(), 1);
+}
+
+TEST_F(SaveQueueTest, flushesOnStop) {
+    {
+        SaveQueue saveQueue(folder, folder / "project.xml");
+        saveQueue.start();
+        saveQueue.saveChunk(makeChunk(1, 0), gfx::ChunkCodec::kRunLength);
+    }
+    EXPECT_TRUE(std::filesystem::exists(folder / "r.0.0.vxr"));
+}
+
+TEST_F(SaveQueueTest, readsMetadataThenVoxelsOnDemand) {
+    {
+        SaveQueue saveQueue(folder, folder / "project.xml");
+        auto chunk = makeChunk(1, 0);
+        chunk.name = std::string(300, 'n');
+        saveQueue.saveChunk(chunk, gfx::ChunkCodec::kRunLengthLz);
+
+        // Different voxels, so each chunk has to load its own
+        auto other = makeChunk(2, 0);
+        other.voxels.mutableVoxels()[3] = gfx::BlockType::kDirt;
+        saveQueue.saveChunk(other, gfx::ChunkCodec::kRunLengthLz);
+        saveQueue.flush();
+    }
+
+    SaveQueue saveQueue(folder, folder / "project.xml");
+    const auto records = saveQueue.readRegion("r.0.0.vxr", true);
+    ASSERT_TRUE(records.has_value());
+    ASSERT_EQ(records->size(), 2);
+
+    for (const auto &bytes : records.value()) {
+        // The long name takes more than the usual prefix and is still read whole
+        EXPECT_GE(bytes.size(), gfx::chunkMetadataSize(bytes));
+
+        auto chunk = gfx::decodeChunkMetadata(bytes, "r.0.0.vxr");
+        ASSERT_TRUE(chunk.has_value());
+        chunk->voxels = gfx::VoxelStorage::deferred(8, [&saveQueue, chunkIdentifier = chunk->id]() {
+            return gfx::decodeChunkVoxels(saveQueue.readChunk("r.0.0.vxr", chunkIdentifier).value(), "r.0.0.vxr")
+                    .value();
+        });
+
+        EXPECT_FALSE(chunk->voxels.isLoaded());
+        EXPECT_EQ(chunk->voxels.size(), 8);
+        const bool first = chunk->id == makeChunk(1, 0).id;
+        EXPECT_EQ(chunk->voxels.at(3), first ? gfx::BlockType::kGrass : gfx::BlockType::kDirt);
+        EXPECT_EQ(chunk->voxels.at(0), gfx::BlockType::kGrass);
+        EXPECT_TRUE(chunk->voxels.isLoaded());
+    }
+}
+
+TEST_F(SaveQueueTest, storesIdenticalVoxelsOnce) {
+    {
+        SaveQueue saveQueue(folder, folder / "project.xml");
+        for (u8 seed = 1; seed <= 4; ++seed) { saveQueue.saveChunk(makeChunk(seed, 0), gfx::ChunkCodec::kNone); }
+        saveQueue.flush();
+
+        // Editing one chunk adds a blob, the old one is still used by the others
+        auto edited = makeChunk(1, 0);
+        edited.voxels.mutableVoxels()[0] = gfx::BlockType::kDirt;
+        saveQueue.saveChunk(edited, gfx::ChunkCodec::kNone);
+        saveQueue.flush();
+
+        auto blobs = gfx::BlobStore::open(folder / gfx::kBlobStoreFileName);
+        ASSERT_TRUE(blobs.has_value());
+        EXPECT_EQ(blobs->size(), 2);
+    }
+
+    SaveQueue saveQueue(folder, folder / "project.xml");
+    const auto chunks = loadRegion(saveQueue, "r.0.0.vxr");
+    ASSERT_TRUE(chunks.has_value());
+    ASSERT_EQ(chunks->size(), 4);
+    for (const auto &chunk : chunks.value()) {
+        EXPECT_EQ(chunk.voxels.at(0), chunk.id == makeChunk(1, 0).id ? gfx::BlockType::kDirt : gfx::BlockType::kGrass);
+    }
+
+    // Deleting the unedited chunks leaves their blob unreferenced
+    for (u8 seed = 2; seed <= 4; ++seed) { saveQueue.deleteChunk(makeChunk(seed, 0).id); }
+    saveQueue.flush();
+    EXPECT_EQ(saveQueue.collectBlobs(), 1);
+    EXPECT_EQ(saveQueue.collectBlobs(), 0);
+}
+
+TEST_F(SaveQueueTest, compactsTheManifestJournal) {
+    SaveQueue saveQueue(folder, folder / "project.xml");
+    const auto journalPath = manifestJournalPath(folder / "project.xml");
+
+    saveQueue.appendManifestRecord({1, ManifestRecordType::kAddRegion, "r.0.0.vxr"});
+    saveQueue.appendManifestRecord({2, ManifestRecordType::kAddRegion, "r.1.0.vxr"});
+    saveQueue.flush();
+    saveQueue.appendManifestRecord({3, ManifestRecordType::kRemoveRegion, "r.0.0.vxr"});
+    saveQueue.flush();
+    EXPECT_EQ(readManifestJournal(journalPath).records.size(), 3);
+
+    // A project file taking in the first three records leaves only the later ones in the journal
+    saveQueue.saveProjectFile("<project/>", 3);
+    saveQueue.appendManifestRecord({4, ManifestRecordType::kSetChunkCodec, "none"});
+    saveQueue.flush();
+
+    const auto journal = readManifestJournal(journalPath);
+    ASSERT_EQ(journal.records.size(), 1);
+    EXPECT_EQ(journal.records.front().sequence, 4);
+    EXPECT_TRUE(std::filesystem::exists(folder / "project.xml"));
+}
@@ -0,0 +1,55 @@
+#include "../src/util/slot_map.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace vx::util;
+
+TEST(TestSlotMap, handlesSurviveOtherErasures) {
+    SlotMap<std::string> names;
+    const auto first = names.emplace("first");
+    const auto second = names.emplace("second");
+    const auto third = names.emplace("third");
+
+    // Erasing moves the last value into the hole, the handle still finds it
+    EXPECT_TRUE(names.erase(first));
+    EXPECT_EQ(names.size(), 2);
+    EXPECT_EQ(names.at(second), "second");
+    EXPECT_EQ(names.at(third), "third");
+    EXPECT_EQ(names.values().front(), "third");
+    EXPECT_EQ(names.handles().front(), third);
+}
+
+TEST(TestSlotMap, detectsStaleHandles) {
+    SlotMap<int> values;
+    const auto erased = values.insert(1);
+    values.erase(erased);
+
+    // The freed slot is reused by the next value under a new generation
+    const auto reused = values.insert(2);
+    EXPECT_EQ(reused.index(), erased.index());
+    EXPECT_NE(reused, erased);
+
+    EXPECT_FALSE(values.contains(erased));
+    EXPECT_EQ(values.get(erased), nullptr);
+    EXPECT_THROW(values.at(erased), std::out_of_range);
+    EXPECT_FALSE(values.erase(erased));
+    EXPECT_EQ(values.at(reused), 2);
+
+    EXPECT_FALSE(values.contains(SlotHandle()));
+}
+
+TEST(TestSlotMap, retiresSlotsOutOfGenerations) {
+    SlotMap<int> values;
+    SlotHandle handle = values.insert(0);
+    const u32 index = handle.index();
+    for (u32 generation = 0; generation < SlotHandle::kMaxGeneration; ++generation) {
+        values.erase(handle);
+        handle = values.insert(0);
+        ASSERT_EQ(handle.index(), index);
+    }
+    EXPECT_EQ(handle.generation(), SlotHandle::kMaxGeneration);
+
+    // Reusing the slot again would wrap its generation and revive handles from its first use
+    values.erase(handle);
+    EXPECT_NE(values.insert(0).index(), index);
+}
@@ -0,0 +1,503 @@
+#include "../src/gfx/blob_store.h"
+#include "../src/gfx/chunk_file.h"
+#include "../src/gfx/legacy_chunk.h"
+#include "../src/gfx/region_file.h"
+#include "../src/level_editor/manifest_journal.h"
+#include "../src/level_editor/project_version.h"
+#include "../src/paths.h"
+#include "../src/util/strings.h"
+#include "../src/util/thread_pool.h"
+#include "../src/util/timer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <pugixml.hpp>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// Converts a project folder between the chunk layouts the editor has used: a legacy XML file per chunk, a .vxc
+// file per chunk, or region files. Only voxel_lib's file formats are used, no window is ever opened.
+namespace vx::convert {
+    // Chunks parsed, encoded or written per thread pool job
+    constexpr usize kBatchSize = 64;
+
+    constexpr auto kProjectFileName = "project.xml";
+    constexpr auto kGameObjectFolderName = "game_objects";
+
+    enum class Format { kXml, kChunkFiles, kRegions };
+
+    struct Options {
+        Format format = Format::kRegions;
+        gfx::ChunkCodec codec = gfx::kDefaultChunkCodec;
+        usize nThreads = std::max(1u, std::thread::hardware_concurrency());
+        bool verify = true;
+        fs::path input;
+        fs::path output;
+    };
+
+    struct Project {
+        std::string name;
+        std::vector<gfx::Chunk> chunks;
+    };
+
+    struct EncodedChunk {
+        std::vector<u8> bytes;
+
+        // Region files keep the voxels in the blob store, the other formats have them in `bytes`
+        std::vector<u8> blob;
+        util::Hash128 blobHash;
+    };
+
+    struct Stage {
+        u64 chunks = 0;
+        u64 bytes = 0;
+        double seconds = 0;
+    };
+
+    static void report(const char *name, const Stage &stage) {
+        const double megabytes = static_cast<double>(stage.bytes) / (1024.0 * 1024.0);
+        const double throughput = stage.seconds > 0 ? megabytes / stage.seconds : 0.0;
+        spdlog::info("{:<7} {:>8} chunks {:>10.2f} MB {:>8.3f} s {:>10.2f} MB/s", name, stage.chunks, megabytes,
+                     stage.seconds, throughput);
+    }
+
+    /**
+     * Runs `fn` over [0, n) a kBatchSize range at a time on the pool and waits for every range.
+     * @param {Fn} fn - Called with the range's begin and end, returns the number of bytes it handled
+     * @return The total bytes handled
+     */
+    template<typename Fn>
+    static auto forEachBatch(util::ThreadPool &pool, usize n, const Fn &fn) -> u64 {
+        std::vector<std::future<u64>> batches;
+        for (usize begin = 0; begin < n; begin += kBatchSize) {
+            const usize end = std::min(begin + kBatchSize, n);
+            batches.push_back(pool.submit([&fn, begin, end]() { return fn(begin, end); }));
+        }
+
+        u64 bytes = 0;
+        for (auto &batch : batches) { bytes += batch.get(); }
+        return bytes;
+    }
+
+    static auto writeFile(const fs::path &path, std::span<const u8> bytes) -> bool {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        file.close();
+        if (!file) { spdlog::error("Failed to write {}", path.string()); }
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * Reads every chunk a project lists, whichever layout it is stored in. Region files are read in parallel, then
+     * all chunks are parsed in parallel.
+     */
+    static auto readProject(const fs::path &folder, util::ThreadPool &pool, Stage &stage) -> std::optional<Project> {
+        util::Timer timer;
+        timer.start();
+
+        const fs::path projectFilePath = folder / kProjectFileName;
+        pugi::xml_document projectDocument;
+        const pugi::xml_parse_result parseResult = projectDocument.load_file(projectFilePath.c_str());
+        if (!parseResult) {
+            spdlog::error("Failed to load {} with error: {}", projectFilePath.string(), parseResult.description());
+            return std::nullopt;
+        }
+
+        const pugi::xml_node projectNode = projectDocument.child("project");
+        const fs::path gameObjectFolderPath = folder / kGameObjectFolderName;
+
+        // The regions the editor would open, journal included
+        auto manifest = level_editor::Manifest::fromProjectNode(projectNode);
+        manifest.replay(level_editor::readManifestJournal(level_editor::manifestJournalPath(projectFilePath)));
+
+        using RegionRecords = std::optional<std::vector<std::vector<u8>>>;
+        std::vector<std::pair<std::string, std::future<RegionRecords>>> regionReads;
+        for (const auto &fileName : manifest.regionFileNames) {
+            const fs::path regionPath = gameObjectFolderPath / fileName;
+            regionReads.emplace_back(fileName, pool.submit([regionPath]() -> RegionRecords {
+                // Opening a region creates it when it's missing
+                if (!fs::exists(regionPath)) { return std::nullopt; }
+                auto regionFile = gfx::RegionFile::open(regionPath);
+                if (!regionFile.has_value()) { return std::nullopt; }
+                return regionFile->readAll();
+            }));
+        }
+
+        std::vector<std::vector<u8>> records;
+        std::vector<std::string> recordSources;
+        bool failed = false;
+        for (auto &[fileName, regionRead] : regionReads) {
+            auto regionRecords = regionRead.get();
+            if (!regionRecords.has_value()) {
+                spdlog::error("Region {} failed to load", fileName);
+                failed = true;
+                continue;
+            }
+            for (auto &record : regionRecords.value()) {
+                records.push_back(std::move(record));
+                recordSources.push_back(fileName);
+            }
+        }
+
+        // Voxels shared through the blob store are read once for every chunk holding them
+        std::unordered_map<util::Hash128, std::vector<u8>> blobs;
+        std::optional<gfx::BlobStore> blobStore;
+        const fs::path blobStorePath = gameObjectFolderPath / gfx::kBlobStoreFileName;
+        for (const auto &record : records) {
+            const auto hash = gfx::chunkBlobHash(record);
+            if (!hash.has_value() || blobs.contains(hash.value())) { continue; }
+
+            if (!blobStore.has_value() && fs::exists(blobStorePath)) {
+                blobStore = gfx::BlobStore::open(blobStorePath);
+            }
+            auto blob = blobStore.has_value() ? blobStore->read(hash.value()) : std::nullopt;
+            if (!blob.has_value()) {
+                spdlog::error("Blob {} is missing", hash->toString());
+                failed = true;
+                continue;
+            }
+            blobs.emplace(hash.value(), std::move(blob.value()));
+        }
+
+        // Projects from before region files list a legacy XML or .vxc file per chunk
+        std::vector<fs::path> chunkPaths;
+        const pugi::xml_node gameObjectsComponent =
+                projectNode.find_child_by_attribute("component", "name", "gameObjects");
+        for (const auto &child : gameObjectsComponent.child("game-objects-list").children()) {
+            chunkPaths.push_back(gameObjectFolderPath / child.attribute("path").value());
+        }
+
+        std::vector<std::optional<gfx::Chunk>> chunks(records.size() + chunkPaths.size());
+        stage.bytes = forEachBatch(pool, chunks.size(), [&](usize begin, usize end) {
+            u64 bytes = 0;
+            for (usize ii = begin; ii < end; ++ii) {
+                if (ii < records.size()) {
+                    const auto &record = records.at(ii);
+                    const auto hash = gfx::chunkBlobHash(record);
+                    if (hash.has_value() && blobs.contains(hash.value())) {
+                        const auto &blob = blobs.at(hash.value());
+                        chunks.at(ii) = gfx::decodeChunk(gfx::attachChunkBlob(record, blob), recordSources.at(ii));
+                        bytes += blob.size();
+                    } else {
+                        chunks.at(ii) = gfx::decodeChunk(record, recordSources.at(ii));
+                    }
+                    bytes += record.size();
+                } else {
+                    const auto &chunkPath = chunkPaths.at(ii - records.size());
+                    chunks.at(ii) = gfx::Chunk::load(chunkPath);
+                    std::error_code error;
+                    const auto fileSize = fs::file_size(chunkPath, error);
+                    bytes += error ? 0 : fileSize;
+                }
+            }
+            return bytes;
+        });
+
+        Project project;
+        project.name = projectNode.attribute("name").value();
+        project.chunks.reserve(chunks.size());
+        for (auto &chunk : chunks) {
+            if (!chunk.has_value()) {
+                failed = true;
+                continue;
+            }
+            project.chunks.push_back(std::move(chunk.value()));
+        }
+
+        stage.chunks = project.chunks.size();
+        stage.seconds = timer.elapsed();
+        if (failed) {
+            spdlog::error("Some chunks of {} could not be read", folder.string());
+            return std::nullopt;
+        }
+        return project;
+    }
+
+    static auto encodeChunks(const Project &project, const Options &options, util::ThreadPool &pool, Stage &stage)
+            -> std::optional<std::vector<EncodedChunk>> {
+        util::Timer timer;
+        timer.start();
+
+        std::atomic<bool> failed = false;
+        std::vector<EncodedChunk> encoded(project.chunks.size());
+        stage.bytes = forEachBatch(pool, encoded.size(), [&](usize begin, usize end) {
+            u64 bytes = 0;
+            for (usize ii = begin; ii < end; ++ii) {
+                const auto &chunk = project.chunks.at(ii);
+                auto &encodedChunk = encoded.at(ii);
+                if (options.format == Format::kXml) {
+                    const auto xml = gfx::encodeLegacyChunk(chunk, project.name);
+                    encodedChunk.bytes.assign(xml.begin(), xml.end());
+                } else if (options.format == Format::kChunkFiles) {
+                    auto bytes = gfx::encodeChunk(chunk, options.codec);
+                    if (!bytes.has_value()) {
+                        failed = true;
+                        continue;
+                    }
+                    encodedChunk.bytes = std::move(bytes.value());
+                } else {
+                    auto chunkBlob = gfx::encodeChunkBlob(chunk, options.codec);
+                    if (!chunkBlob.has_value()) {
+                        failed = true;
+                        continue;
+                    }
+                    encodedChunk = {std::move(chunkBlob->record), std::move(chunkBlob->voxels), chunkBlob->hash};
+                }
+                bytes += encodedChunk.bytes.size() + encodedChunk.blob.size();
+            }
+            return bytes;
+        });
+
+        stage.chunks = encoded.size();
+        stage.seconds = timer.elapsed();
+        if (failed) { return std::nullopt; }
+        return encoded;
+    }
+
+    /**
+     * The project file pointing at the written chunks, in the layout the editor expects for the format.
+     */
+    static auto encodeProjectFile(const Project &project, const Options &options,
+                                  const std::vector<std::string> &fileNames) -> std::string {
+        pugi::xml_document projectDocument;
+        pugi::xml_node projectNode = projectDocument.append_child("project");
+        projectNode.append_attribute("name") = project.name.c_str();
+        projectNode.append_attribute("version") =
+                util::semverToString(level_editor::kProjectFileVersionMajor, level_editor::kProjectFileVersionMinor,
+                                     level_editor::kProjectFileVersionPatch)
+                        .c_str();
+
+        const bool regions = options.format == Format::kRegions;
+        if (regions) {
+            projectNode.append_attribute("chunkCodec") = gfx::chunkCodecToString(options.codec).c_str();
+            projectNode.append_attribute("journalSequence") = "0";
+        }
+
+        pugi::xml_node component = projectNode.append_child("component");
+        component.append_attribute("name") = regions ? "regions" : "gameObjects";
+
+        pugi::xml_node nNodesProperty = component.append_child("property");
+        nNodesProperty.append_attribute("name") = "nNodes";
+        nNodesProperty.append_attribute("value") = fileNames.size();
+
+        pugi::xml_node list = component.append_child(regions ? "regions-list" : "game-objects-list");
+        for (usize ii = 0; ii < fileNames.size(); ++ii) {
+            pugi::xml_node itemNode = list.append_child("item");
+            if (!regions) { itemNode.append_attribute("name") = project.chunks.at(ii).name.c_str(); }
+            itemNode.append_attribute("path") = fileNames.at(ii).c_str();
+        }
+
+        std::ostringstream contents;
+        projectDocument.save(contents);
+        return contents.str();
+    }
+
+    static auto writeProject(const Project &project, const std::vector<EncodedChunk> &encoded,
+                             const Options &options, util::ThreadPool &pool, Stage &stage) -> bool {
+        util::Timer timer;
+        timer.start();
+
+        const fs::path gameObjectFolderPath = options.output / kGameObjectFolderName;
+        std::error_code error;
+        fs::create_directories(gameObjectFolderPath, error);
+        if (error) {
+            spdlog::error("Failed to create {}: {}", gameObjectFolderPath.string(), error.message());
+            return false;
+        }
+
+        std::atomic<bool> failed = false;
+        std::vector<std::string> fileNames;
+        if (options.format == Format::kRegions) {
+            // Chunks with the same voxels share a blob, which is stored before any region refers to it
+            std::vector<gfx::BlobWrite> blobWrites;
+            std::unordered_set<util::Hash128> blobHashes;
+            for (const auto &encodedChunk : encoded) {
+                if (!blobHashes.insert(encodedChunk.blobHash).second) { continue; }
+                blobWrites.push_back({encodedChunk.blobHash, encodedChunk.blob});
+                stage.bytes += encodedChunk.blob.size();
+            }
+
+            auto blobStore = gfx::BlobStore::open(gameObjectFolderPath / gfx::kBlobStoreFileName);
+            if (!blobStore.has_value() || !blobStore->write(blobWrites)) {
+                spdlog::error("Failed to write the blob store");
+                return false;
+            }
+            spdlog::info("{} chunks share {} blobs", encoded.size(), blobWrites.size());
+
+            std::map<std::string, std::vector<usize>> regionChunks;
+            for (usize ii = 0; ii < project.chunks.size(); ++ii) {
+                const auto &chunk = project.chunks.at(ii);
+                regionChunks[gfx::regionFileName(gfx::regionCoordinates(chunk.translation()))].push_back(ii);
+            }
+
+            // Regions are independent files, so each is written by its own job
+            std::vector<std::future<u64>> regionWrites;
+            for (const auto &[fileName, indices] : regionChunks) {
+                fileNames.push_back(fileName);
+                const fs::path regionPath = gameObjectFolderPath / fileName;
+                regionWrites.push_back(pool.submit([&, regionPath, &indices = indices]() -> u64 {
+                    auto regionFile = gfx::RegionFile::open(regionPath);
+                    std::vector<gfx::RegionWrite> writes;
+                    u64 bytes = 0;
+                    for (const usize index : indices) {
+                        writes.push_back({project.chunks.at(index).id, encoded.at(index).bytes});
+                        bytes += encoded.at(index).bytes.size();
+                    }
+
+                    if (!regionFile.has_value() || !regionFile->write(writes)) {
+                        spdlog::error("Failed to write region {}", regionPath.string());
+                        failed = true;
+                    }
+                    return bytes;
+                }));
+            }
+            for (auto &regionWrite : regionWrites) { stage.bytes += regionWrite.get(); }
+        } else {
+            const auto *postfix = options.format == Format::kXml ? paths::kXmlPostfix : paths::kChunkPostfix;
+            for (const auto &chunk : project.chunks) { fileNames.push_back(uuids::to_string(chunk.id) + postfix); }
+
+            stage.bytes = forEachBatch(pool, encoded.size(), [&](usize begin, usize end) {
+                u64 bytes = 0;
+                for (usize ii = begin; ii < end; ++ii) {
+                    if (!writeFile(gameObjectFolderPath / fileNames.at(ii), encoded.at(ii).bytes)) { failed = true; }
+                    bytes += encoded.at(ii).bytes.size();
+                }
+                return bytes;
+            });
+        }
+
+        const auto contents = encodeProjectFile(project, options, fileNames);
+        const std::span<const u8> contentBytes(reinterpret_cast<const u8 *>(contents.data()), contents.size());
+        if (!writeFile(options.output / kProjectFileName, contentBytes)) { failed = true; }
+
+        stage.chunks = project.chunks.size();
+        stage.seconds = timer.elapsed();
+        return !failed;
+    }
+
+    static auto sameChunk(const gfx::Chunk &chunk, const gfx::Chunk &other) -> bool {
+        return chunk.id == other.id && chunk.name == other.name && chunk.shaderModule == other.shaderModule &&
+               chunk.isStatic == other.isStatic && chunk.blockType == other.blockType &&
+               chunk.dimensions() == other.dimensions() && chunk.translation() == other.translation() &&
+               chunk.voxels == other.voxels;
+    }
+
+    /**
+     * Reads the converted project back and compares it chunk by chunk with the source.
+     */
+    static auto verifyProject(const Project &source, util::ThreadPool &pool, const Options &options) -> bool {
+        Stage stage;
+        const auto converted = readProject(options.output, pool, stage);
+        report("verify", stage);
+        if (!converted.has_value()) { return false; }
+
+        std::unordered_map<uuids::uuid, const gfx::Chunk *> convertedChunks;
+        for (const auto &chunk : converted->chunks) { convertedChunks[chunk.id] = &chunk; }
+
+        usize mismatches = 0;
+        for (const auto &chunk : source.chunks) {
+            const auto found = convertedChunks.find(chunk.id);
+            if (found == convertedChunks.end() || !sameChunk(chunk, *found->second)) {
+                spdlog::error("Chunk {} ({}) did not survive the conversion", chunk.name, uuids::to_string(chunk.id));
+                ++mismatches;
+            }
+        }
+
+        if (converted->chunks.size() != source.chunks.size()) {
+            spdlog::error("Converted project holds {} chunks, expected {}", converted->chunks.size(),
+                          source.chunks.size());
+            return false;
+        }
+        return mismatches == 0;
+    }
+
+    static auto parseOptions(int argc, char *argv[]) -> std::optional<Options> {
+        Options options;
+        for (int ii = 1; ii < argc; ++ii) {
+            const std::string_view argument(argv[ii]);
+            const bool hasValue = ii + 1 < argc;
+            if (argument == "--to" && hasValue) {
+                const std::string_view format(argv[++ii]);
+                if (format == "xml") {
+                    options.format = Format::kXml;
+                } else if (format == "vxc") {
+                    options.format = Format::kChunkFiles;
+                } else if (format == "region") {
+                    options.format = Format::kRegions;
+                } else {
+                    spdlog::error("Unknown format {}, expected xml, vxc or region", format);
+                    return std::nullopt;
+                }
+            } else if (argument == "--codec" && hasValue) {
+                const std::string codec(argv[++ii]);
+                if (std::find(gfx::kAvailableChunkCodecs.begin(), gfx::kAvailableChunkCodecs.end(), codec) ==
+                    gfx::kAvailableChunkCodecs.end()) {
+                    spdlog::error("Unknown codec {}, expected none, rle or rle+lz", codec);
+                    return std::nullopt;
+                }
+                options.codec = gfx::chunkCodecFromString(codec);
+            } else if (argument == "--threads" && hasValue) {
+                options.nThreads = std::max(1, std::atoi(argv[++ii]));
+            } else if (argument == "--output" && hasValue) {
+                options.output = argv[++ii];
+            } else if (argument == "--no-verify") {
+                options.verify = false;
+            } else if (!argument.starts_with("--") && options.input.empty()) {
+                options.input = argument;
+            } else {
+                spdlog::error("Unexpected argument {}", argument);
+                return std::nullopt;
+            }
+        }
+
+        if (options.input.empty() || options.output.empty()) {
+            spdlog::error("Usage: voxel-convert [--to xml|vxc|region] [--codec none|rle|rle+lz] [--threads N] "
+                          "[--no-verify] --output <project folder> <project folder>");
+            return std::nullopt;
+        }
+
+        // Regions are opened in place, so anything already in the output would be mixed into the converted project
+        if (fs::exists(options.output / kProjectFileName)) {
+            spdlog::error("{} already holds a project", options.output.string());
+            return std::nullopt;
+        }
+        return options;
+    }
+}// namespace vx::convert
+
+int main(int argc, char *argv[]) {
+    using namespace vx::convert;
+
+    const auto options = parseOptions(argc, argv);
+    if (!options.has_value()) { return 2; }
+
+    vx::util::ThreadPool pool(options->nThreads);
+    spdlog::info("Converting {} to {} on {} threads", options->input.string(), options->output.string(), pool.size());
+
+    Stage parse;
+    const auto project = readProject(options->input, pool, parse);
+    report("parse", parse);
+    if (!project.has_value()) { return 1; }
+
+    Stage encode;
+    const auto encoded = encodeChunks(project.value(), options.value(), pool, encode);
+    report("encode", encode);
+    if (!encoded.has_value()) { return 1; }
+
+    Stage write;
+    const bool written = writeProject(project.value(), encoded.value(), options.value(), pool, write);
+    report("write", write);
+    if (!written) { return 1; }
+
+    if (options->verify && !verifyProject(project.value(), pool, options.value())) {
+        spdlog::error("Round trip verification failed");
+        return 1;
+    }
+    return 0;
+}